@@ -0,0 +1,88 @@
+//
+// Copyright (C) 2025 llw
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+
+// 替换全局operator new并统计调用次数，供ModbusSlaveApp的countAllocations参数读取
+// （不依赖OMNeT++/INET，不参与仿真库编译）：
+//   g++ -O2 -shared -fPIC AllocationCounter.cc -o libAllocationCounter.so
+// 在ModbusTest1目录下预加载后运行仿真：
+//   LD_PRELOAD=../bench/libAllocationCounter.so ./ModbusTest1 -u Cmdenv -n .:$INET_ROOT/src -c General --**.client[*].app[0].countAllocations=true
+// 结果见从站的allocationsPerRequest统计和meanAllocationsPerRequest标量。
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<unsigned long> allocationCount{0};
+
+void *allocate(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void *allocateAligned(std::size_t size, std::align_val_t alignment)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (align < sizeof(void *))
+        align = sizeof(void *);
+    void *p = nullptr;
+    return posix_memalign(&p, align, size ? size : 1) == 0 ? p : nullptr;
+}
+
+} // namespace
+
+extern "C" unsigned long modbusAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+void *operator new(std::size_t size)
+{
+    if (void *p = allocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void *p = allocateAligned(size, alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t&) noexcept { std::free(p); }
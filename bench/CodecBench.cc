@@ -0,0 +1,148 @@
+//
+// Copyright (C) 2025 llw
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+
+// ModbusCodec.h的独立微基准（不依赖OMNeT++/INET，不参与仿真库编译）：
+//   g++ -O3 -mssse3 -I../inet/modbusapp CodecBench.cc -o CodecBench && ./CodecBench
+// 去掉-mssse3测SSE2路径，再加-mno-sse2测64位字路径。
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "ModbusCodec.h"
+
+using namespace inet;
+
+namespace {
+
+const size_t NUM_REGISTERS = 125;  // 一次0x03/0x04读取的最大寄存器数
+const size_t NUM_COILS = 2000;     // 一次0x01/0x02读取的最大线圈数
+
+// 逐个寄存器的标量实现（ModbusCodec.h之前主站分发响应时的写法）
+__attribute__((noinline)) void decodeRegistersScalar(int16_t* dst, const uint8_t* src, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        dst[i] = int16_t(uint16_t(src[2 * i]) << 8 | src[2 * i + 1]);
+}
+
+__attribute__((noinline)) void encodeRegistersScalar(uint8_t* dst, const int16_t* src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[2 * i] = uint16_t(src[i]) >> 8;
+        dst[2 * i + 1] = uint16_t(src[i]) & 0xFF;
+    }
+}
+
+// 逐位实现（ModbusCodec.h之前主站分发0x01/0x02响应与从站打包读响应的写法）
+__attribute__((noinline)) void unpackBitsScalar(uint8_t* dst, const uint8_t* src, size_t bitOffset, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (src[(bitOffset + i) / 8] >> ((bitOffset + i) % 8)) & 0x01;
+}
+
+__attribute__((noinline)) void packBitsScalar(uint8_t* dst, const uint8_t* src, size_t count) {
+    uint8_t currentByte = 0;
+    int bitPos = 0;
+    for (size_t i = 0; i < count; i++) {
+        currentByte |= (src[i] & 0x01) << bitPos++;
+        if (bitPos >= 8) {
+            *dst++ = currentByte;
+            currentByte = 0;
+            bitPos = 0;
+        }
+    }
+    if (bitPos > 0)
+        *dst = currentByte;
+}
+
+template <typename Func>
+double nsPerCall(long iterations, Func func) {
+    auto start = std::chrono::steady_clock::now();
+    for (long n = 0; n < iterations; n++) {
+        func();
+        asm volatile("" ::: "memory");  // 防止编译器合并或省略重复调用
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        fprintf(stderr, "mismatch: %s\n", what);
+        exit(1);
+    }
+}
+
+void benchRegisters(long iterations) {
+    std::mt19937 rng(1);
+    std::vector<uint8_t> frame(2 * NUM_REGISTERS);
+    for (auto& b : frame)
+        b = rng();
+    std::vector<int16_t> regs(NUM_REGISTERS), ref(NUM_REGISTERS);
+    std::vector<uint8_t> out(2 * NUM_REGISTERS);
+
+    decodeRegisters(regs.data(), frame.data(), NUM_REGISTERS);
+    decodeRegistersScalar(ref.data(), frame.data(), NUM_REGISTERS);
+    check(regs == ref, "decodeRegisters");
+    encodeRegisters(out.data(), regs.data(), NUM_REGISTERS);
+    check(out == frame, "encodeRegisters");
+
+    printf("registers x%zu (%s):\n", NUM_REGISTERS,
+#if defined(__SSSE3__)
+            "SSSE3 path"
+#elif defined(__SSE2__)
+            "SSE2 path"
+#else
+            "64-bit word path"
+#endif
+            );
+    printf("  decode  scalar %7.1f ns   codec %7.1f ns\n",
+            nsPerCall(iterations, [&] { decodeRegistersScalar(ref.data(), frame.data(), NUM_REGISTERS); }),
+            nsPerCall(iterations, [&] { decodeRegisters(regs.data(), frame.data(), NUM_REGISTERS); }));
+    printf("  encode  scalar %7.1f ns   codec %7.1f ns\n",
+            nsPerCall(iterations, [&] { encodeRegistersScalar(out.data(), ref.data(), NUM_REGISTERS); }),
+            nsPerCall(iterations, [&] { encodeRegisters(out.data(), regs.data(), NUM_REGISTERS); }));
+}
+
+void benchBits(long iterations) {
+    std::mt19937 rng(2);
+    const size_t maxOffset = 7;
+    std::vector<uint8_t> frame((NUM_COILS + maxOffset + 7) / 8);
+    for (auto& b : frame)
+        b = rng();
+    std::vector<uint8_t> points(NUM_COILS), ref(NUM_COILS);
+    std::vector<uint8_t> packed((NUM_COILS + 7) / 8), packedRef((NUM_COILS + 7) / 8);
+
+    printf("coils x%zu (%s):\n", NUM_COILS,
+#if defined(__SSE2__)
+            "SSE2 pack, 64-bit unpack"
+#else
+            "64-bit pack/unpack"
+#endif
+            );
+    for (size_t offset : {size_t(0), size_t(3)}) {
+        unpackBits(points.data(), frame.data(), offset, NUM_COILS);
+        unpackBitsScalar(ref.data(), frame.data(), offset, NUM_COILS);
+        check(points == ref, "unpackBits");
+        printf("  unpack  offset %zu  per-bit %7.1f ns   codec %7.1f ns\n", offset,
+                nsPerCall(iterations, [&] { unpackBitsScalar(ref.data(), frame.data(), offset, NUM_COILS); }),
+                nsPerCall(iterations, [&] { unpackBits(points.data(), frame.data(), offset, NUM_COILS); }));
+    }
+    packBits(packed.data(), points.data(), NUM_COILS);
+    packBitsScalar(packedRef.data(), points.data(), NUM_COILS);
+    check(packed == packedRef, "packBits");
+    printf("  pack              per-bit %7.1f ns   codec %7.1f ns\n",
+            nsPerCall(iterations, [&] { packBitsScalar(packedRef.data(), points.data(), NUM_COILS); }),
+            nsPerCall(iterations, [&] { packBits(packed.data(), points.data(), NUM_COILS); }));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 2000000;
+    benchRegisters(iterations);
+    benchBits(iterations / 10);
+    return 0;
+}
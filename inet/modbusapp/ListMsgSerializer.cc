@@ -20,6 +20,13 @@ void ListMsgSerializer::serialize(MemoryOutputStream& stream, const Ptr<const Ch
     const auto& msg = staticPtrCast<const ListMsg>(chunk);
     stream.writeUint32Be(msg->getSequenceNumber());
     stream.writeByte(msg->getIfList());
+    stream.writeByte(msg->getSnapshotMode());
+    stream.writeUint64Be(msg->getLastSeenVersion());
+    // 字符串字段：先写长度，再写内容
+    const char* subscription = msg->getSubscription();
+    uint16_t subscriptionLen = strlen(subscription);
+    stream.writeUint16Be(subscriptionLen);
+    stream.writeBytes(reinterpret_cast<const uint8_t*>(subscription), B(subscriptionLen));
 }
 
 const Ptr<Chunk> ListMsgSerializer::deserialize(MemoryInputStream& stream) const
@@ -27,6 +34,13 @@ const Ptr<Chunk> ListMsgSerializer::deserialize(MemoryInputStream& stream) const
     auto msg = makeShared<ListMsg>();
     msg->setSequenceNumber(stream.readUint32Be());
     msg->setIfList(stream.readByte() ? true : false);
+    msg->setSnapshotMode(stream.readByte());
+    msg->setLastSeenVersion(stream.readUint64Be());
+    uint16_t subscriptionLen = stream.readUint16Be();
+    std::string subscription(subscriptionLen, '\0');
+    for (uint16_t i = 0; i < subscriptionLen; i++)
+        subscription[i] = stream.readByte();
+    msg->setSubscription(subscription.c_str());
     return msg;
 }
 
@@ -156,7 +156,7 @@ Register_Class(ListMsg)
 
 ListMsg::ListMsg() : ::inet::FieldsChunk()
 {
-    this->setChunkLength(B(5));
+    this->setChunkLength(B(16));
 
 }
 
@@ -181,6 +181,9 @@ void ListMsg::copy(const ListMsg& other)
 {
     this->sequenceNumber = other.sequenceNumber;
     this->ifList = other.ifList;
+    this->snapshotMode = other.snapshotMode;
+    this->lastSeenVersion = other.lastSeenVersion;
+    this->subscription = other.subscription;
 }
 
 void ListMsg::parsimPack(omnetpp::cCommBuffer *b) const
@@ -188,6 +191,9 @@ void ListMsg::parsimPack(omnetpp::cCommBuffer *b) const
     ::inet::FieldsChunk::parsimPack(b);
     doParsimPacking(b,this->sequenceNumber);
     doParsimPacking(b,this->ifList);
+    doParsimPacking(b,this->snapshotMode);
+    doParsimPacking(b,this->lastSeenVersion);
+    doParsimPacking(b,this->subscription);
 }
 
 void ListMsg::parsimUnpack(omnetpp::cCommBuffer *b)
@@ -195,6 +201,9 @@ void ListMsg::parsimUnpack(omnetpp::cCommBuffer *b)
     ::inet::FieldsChunk::parsimUnpack(b);
     doParsimUnpacking(b,this->sequenceNumber);
     doParsimUnpacking(b,this->ifList);
+    doParsimUnpacking(b,this->snapshotMode);
+    doParsimUnpacking(b,this->lastSeenVersion);
+    doParsimUnpacking(b,this->subscription);
 }
 
 uint32_t ListMsg::getSequenceNumber() const
@@ -219,6 +228,39 @@ void ListMsg::setIfList(bool ifList)
     this->ifList = ifList;
 }
 
+uint8_t ListMsg::getSnapshotMode() const
+{
+    return this->snapshotMode;
+}
+
+void ListMsg::setSnapshotMode(uint8_t snapshotMode)
+{
+    handleChange();
+    this->snapshotMode = snapshotMode;
+}
+
+uint64_t ListMsg::getLastSeenVersion() const
+{
+    return this->lastSeenVersion;
+}
+
+void ListMsg::setLastSeenVersion(uint64_t lastSeenVersion)
+{
+    handleChange();
+    this->lastSeenVersion = lastSeenVersion;
+}
+
+const char * ListMsg::getSubscription() const
+{
+    return this->subscription.c_str();
+}
+
+void ListMsg::setSubscription(const char * subscription)
+{
+    handleChange();
+    this->subscription = subscription;
+}
+
 class ListMsgDescriptor : public omnetpp::cClassDescriptor
 {
   private:
@@ -226,6 +268,9 @@ class ListMsgDescriptor : public omnetpp::cClassDescriptor
     enum FieldConstants {
         FIELD_sequenceNumber,
         FIELD_ifList,
+        FIELD_snapshotMode,
+        FIELD_lastSeenVersion,
+        FIELD_subscription,
     };
   public:
     ListMsgDescriptor();
@@ -292,7 +337,7 @@ const char *ListMsgDescriptor::getProperty(const char *propertyName) const
 int ListMsgDescriptor::getFieldCount() const
 {
     omnetpp::cClassDescriptor *base = getBaseClassDescriptor();
-    return base ? 2+base->getFieldCount() : 2;
+    return base ? 5+base->getFieldCount() : 5;
 }
 
 unsigned int ListMsgDescriptor::getFieldTypeFlags(int field) const
@@ -306,8 +351,11 @@ unsigned int ListMsgDescriptor::getFieldTypeFlags(int field) const
     static unsigned int fieldTypeFlags[] = {
         FD_ISEDITABLE,    // FIELD_sequenceNumber
         FD_ISEDITABLE,    // FIELD_ifList
+        FD_ISEDITABLE,    // FIELD_snapshotMode
+        FD_ISEDITABLE,    // FIELD_lastSeenVersion
+        FD_ISEDITABLE,    // FIELD_subscription
     };
-    return (field >= 0 && field < 2) ? fieldTypeFlags[field] : 0;
+    return (field >= 0 && field < 5) ? fieldTypeFlags[field] : 0;
 }
 
 const char *ListMsgDescriptor::getFieldName(int field) const
@@ -321,8 +369,11 @@ const char *ListMsgDescriptor::getFieldName(int field) const
     static const char *fieldNames[] = {
         "sequenceNumber",
         "ifList",
+        "snapshotMode",
+        "lastSeenVersion",
+        "subscription",
     };
-    return (field >= 0 && field < 2) ? fieldNames[field] : nullptr;
+    return (field >= 0 && field < 5) ? fieldNames[field] : nullptr;
 }
 
 int ListMsgDescriptor::findField(const char *fieldName) const
@@ -331,6 +382,9 @@ int ListMsgDescriptor::findField(const char *fieldName) const
     int baseIndex = base ? base->getFieldCount() : 0;
     if (strcmp(fieldName, "sequenceNumber") == 0) return baseIndex + 0;
     if (strcmp(fieldName, "ifList") == 0) return baseIndex + 1;
+    if (strcmp(fieldName, "snapshotMode") == 0) return baseIndex + 2;
+    if (strcmp(fieldName, "lastSeenVersion") == 0) return baseIndex + 3;
+    if (strcmp(fieldName, "subscription") == 0) return baseIndex + 4;
     return base ? base->findField(fieldName) : -1;
 }
 
@@ -345,8 +399,11 @@ const char *ListMsgDescriptor::getFieldTypeString(int field) const
     static const char *fieldTypeStrings[] = {
         "uint32_t",    // FIELD_sequenceNumber
         "bool",    // FIELD_ifList
+        "uint8_t",    // FIELD_snapshotMode
+        "uint64_t",    // FIELD_lastSeenVersion
+        "string",    // FIELD_subscription
     };
-    return (field >= 0 && field < 2) ? fieldTypeStrings[field] : nullptr;
+    return (field >= 0 && field < 5) ? fieldTypeStrings[field] : nullptr;
 }
 
 const char **ListMsgDescriptor::getFieldPropertyNames(int field) const
@@ -431,6 +488,9 @@ std::string ListMsgDescriptor::getFieldValueAsString(omnetpp::any_ptr object, in
     switch (field) {
         case FIELD_sequenceNumber: return ulong2string(pp->getSequenceNumber());
         case FIELD_ifList: return bool2string(pp->getIfList());
+        case FIELD_snapshotMode: return ulong2string(pp->getSnapshotMode());
+        case FIELD_lastSeenVersion: return uint642string(pp->getLastSeenVersion());
+        case FIELD_subscription: return oppstring2string(pp->getSubscription());
         default: return "";
     }
 }
@@ -449,6 +509,9 @@ void ListMsgDescriptor::setFieldValueAsString(omnetpp::any_ptr object, int field
     switch (field) {
         case FIELD_sequenceNumber: pp->setSequenceNumber(string2ulong(value)); break;
         case FIELD_ifList: pp->setIfList(string2bool(value)); break;
+        case FIELD_snapshotMode: pp->setSnapshotMode(string2ulong(value)); break;
+        case FIELD_lastSeenVersion: pp->setLastSeenVersion(string2uint64(value)); break;
+        case FIELD_subscription: pp->setSubscription((value)); break;
         default: throw omnetpp::cRuntimeError("Cannot set field %d of class 'ListMsg'", field);
     }
 }
@@ -465,6 +528,9 @@ omnetpp::cValue ListMsgDescriptor::getFieldValue(omnetpp::any_ptr object, int fi
     switch (field) {
         case FIELD_sequenceNumber: return (omnetpp::intval_t)(pp->getSequenceNumber());
         case FIELD_ifList: return pp->getIfList();
+        case FIELD_snapshotMode: return (omnetpp::intval_t)(pp->getSnapshotMode());
+        case FIELD_lastSeenVersion: return (omnetpp::intval_t)(pp->getLastSeenVersion());
+        case FIELD_subscription: return pp->getSubscription();
         default: throw omnetpp::cRuntimeError("Cannot return field %d of class 'ListMsg' as cValue -- field index out of range?", field);
     }
 }
@@ -483,6 +549,9 @@ void ListMsgDescriptor::setFieldValue(omnetpp::any_ptr object, int field, int i,
     switch (field) {
         case FIELD_sequenceNumber: pp->setSequenceNumber(omnetpp::checked_int_cast<uint32_t>(value.intValue())); break;
         case FIELD_ifList: pp->setIfList(value.boolValue()); break;
+        case FIELD_snapshotMode: pp->setSnapshotMode(omnetpp::checked_int_cast<uint8_t>(value.intValue())); break;
+        case FIELD_lastSeenVersion: pp->setLastSeenVersion(omnetpp::checked_int_cast<uint64_t>(value.intValue())); break;
+        case FIELD_subscription: pp->setSubscription(value.stringValue()); break;
         default: throw omnetpp::cRuntimeError("Cannot set field %d of class 'ListMsg'", field);
     }
 }
@@ -50,9 +50,12 @@ namespace inet {
  * <pre>
  * class ListMsg extends FieldsChunk
  * {
- *     chunkLength = B(5);
+ *     chunkLength = B(16);
  *     uint32_t sequenceNumber;
  *     bool ifList = true;
+ *     uint8_t snapshotMode = 0;
+ *     uint64_t lastSeenVersion = 0;
+ *     string subscription;
  * }
  * </pre>
  */
@@ -61,6 +64,9 @@ class INET_API ListMsg : public ::inet::FieldsChunk
   protected:
     uint32_t sequenceNumber = 0;
     bool ifList = true;
+    uint8_t snapshotMode = 0;
+    uint64_t lastSeenVersion = 0;
+    ::omnetpp::opp_string subscription;
 
   private:
     void copy(const ListMsg& other);
@@ -82,6 +88,15 @@ class INET_API ListMsg : public ::inet::FieldsChunk
 
     virtual bool getIfList() const;
     virtual void setIfList(bool ifList);
+
+    virtual uint8_t getSnapshotMode() const;
+    virtual void setSnapshotMode(uint8_t snapshotMode);
+
+    virtual uint64_t getLastSeenVersion() const;
+    virtual void setLastSeenVersion(uint64_t lastSeenVersion);
+
+    virtual const char * getSubscription() const;
+    virtual void setSubscription(const char * subscription);
 };
 
 inline void doParsimPacking(omnetpp::cCommBuffer *b, const ListMsg& obj) {obj.parsimPack(b);}
@@ -0,0 +1,164 @@
+//
+// Copyright (C) 2025 llw
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+
+#include "ModbusBehavior.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace inet {
+
+std::unique_ptr<RegisterBehavior> RegisterBehavior::create(const nlohmann::json& j, cRNG *rng)
+{
+    std::string type = j.value("type", "");
+    std::unique_ptr<RegisterBehavior> behavior;
+    if (type == "ramp") {
+        auto ramp = std::make_unique<RampBehavior>();
+        ramp->start = j.value("start", ramp->start);
+        ramp->slope = j.value("slope", ramp->slope);
+        ramp->min = j.value("min", ramp->min);
+        ramp->max = j.value("max", ramp->max);
+        if (ramp->min >= ramp->max)
+            throw cRuntimeError("ramp behavior: min must be less than max");
+        behavior = std::move(ramp);
+    }
+    else if (type == "sine") {
+        auto sine = std::make_unique<SineBehavior>();
+        sine->offset = j.value("offset", sine->offset);
+        sine->amplitude = j.value("amplitude", sine->amplitude);
+        sine->period = j.value("period", sine->period);
+        sine->phase = j.value("phase", sine->phase);
+        sine->phaseStep = j.value("phaseStep", sine->phaseStep);
+        if (sine->period <= 0)
+            throw cRuntimeError("sine behavior: period must be positive");
+        behavior = std::move(sine);
+    }
+    else if (type == "randomWalk") {
+        auto walk = std::make_unique<RandomWalkBehavior>();
+        walk->start = j.value("start", walk->start);
+        walk->step = j.value("step", walk->step);
+        walk->min = j.value("min", walk->min);
+        walk->max = j.value("max", walk->max);
+        walk->rng = rng;
+        behavior = std::move(walk);
+    }
+    else if (type == "counter") {
+        auto counter = std::make_unique<CounterBehavior>();
+        counter->start = j.value("start", counter->start);
+        counter->step = j.value("step", counter->step);
+        counter->max = j.value("max", counter->max);
+        behavior = std::move(counter);
+    }
+    else if (type == "csv") {
+        auto csv = std::make_unique<CsvReplayBehavior>();
+        csv->column = j.value("column", csv->column);
+        csv->loop = j.value("loop", csv->loop);
+        if (csv->column < 1)
+            throw cRuntimeError("csv behavior: column must be at least 1");
+        csv->load(j.value("file", ""));
+        behavior = std::move(csv);
+    }
+    else
+        throw cRuntimeError("Unknown register behavior type '%s'", type.c_str());
+
+    std::string space = j.value("space", "inputRegisters");
+    if (space == "inputRegisters")
+        behavior->space = INPUT_REGISTERS;
+    else if (space == "discreteInputs")
+        behavior->space = DISCRETE_INPUTS;
+    else
+        throw cRuntimeError("Register behavior space must be inputRegisters or discreteInputs, got '%s'", space.c_str());
+    behavior->address = j.at("address").get<uint16_t>();
+    int count = j.value("count", 1);
+    if (count < 1 || count > 0xFFFF)
+        throw cRuntimeError("Register behavior count must be between 1 and 65535");
+    behavior->count = count;
+    return behavior;
+}
+
+double RampBehavior::valueAt(double t, int point)
+{
+    double value = start + slope * t;
+    double range = max - min;
+    if (value > max || value < min)
+        value = min + std::fmod(std::fmod(value - min, range) + range, range);
+    return value;
+}
+
+double SineBehavior::valueAt(double t, int point)
+{
+    return offset + amplitude * std::sin(2 * M_PI * (t / period + phase + point * phaseStep));
+}
+
+double RandomWalkBehavior::valueAt(double t, int point)
+{
+    if (current.size() < count)
+        current.assign(count, start);
+    double& value = current[point];
+    value = std::min(max, std::max(min, value + uniform(rng, -step, step)));
+    return value;
+}
+
+double CounterBehavior::valueAt(double t, int point)
+{
+    if (current.size() < count)
+        current.assign(count, start - step);  // 第一次更新得到start
+    double& value = current[point];
+    value += step;
+    if (value > max)
+        value = start;
+    return value;
+}
+
+void CsvReplayBehavior::load(const std::string& fileName)
+{
+    std::ifstream ifs(fileName);
+    if (!ifs.is_open())
+        throw cRuntimeError("Failed to open behavior trace file: %s", fileName.c_str());
+
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::vector<double> fields;
+        std::stringstream ss(line);
+        std::string field;
+        bool numeric = true;
+        while (std::getline(ss, field, ',')) {
+            char *end = nullptr;
+            double value = strtod(field.c_str(), &end);
+            if (end == field.c_str()) {
+                numeric = false;  // 表头或无法解析的行
+                break;
+            }
+            fields.push_back(value);
+        }
+        if (!numeric || fields.size() < 2)
+            continue;
+        if (!times.empty() && fields[0] < times.back())
+            throw cRuntimeError("Behavior trace %s: time must be non-decreasing", fileName.c_str());
+        times.push_back(fields[0]);
+        rows.emplace_back(fields.begin() + 1, fields.end());
+    }
+    if (times.empty())
+        throw cRuntimeError("Behavior trace %s contains no data rows", fileName.c_str());
+}
+
+double CsvReplayBehavior::valueAt(double t, int point)
+{
+    if (loop && times.back() > 0)
+        t = std::fmod(t, times.back());
+    if (cursor >= times.size() || times[cursor] > t)
+        cursor = 0;  // 循环回到开头
+    while (cursor + 1 < times.size() && times[cursor + 1] <= t)
+        cursor++;
+    const std::vector<double>& row = rows[cursor];
+    size_t index = std::min<size_t>(column - 1 + point, row.size() - 1);
+    return row[index];
+}
+
+} // namespace inet
@@ -0,0 +1,91 @@
+//
+// Copyright (C) 2025 llw
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+
+#ifndef __INET_MODBUSBEHAVIOR_H
+#define __INET_MODBUSBEHAVIOR_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "inet/common/INETDefs.h"
+#include "ModbusStorage.h"
+
+namespace inet {
+
+// -----------------------------------------------------------------------------
+// 仿真从站的寄存器行为：按时间更新输入寄存器/离散输入的数值，用于产生真实的变化率。
+// 每个行为作用于某个寄存器组内连续的count个点；由所属从站的定时器统一批量调用。
+// 位数据取数值四舍五入后非0为1。
+// -----------------------------------------------------------------------------
+class RegisterBehavior
+{
+  public:
+    AddressSpace space = INPUT_REGISTERS;
+    uint16_t address = 0;   // 第一个点的地址
+    uint16_t count = 1;     // 连续点数
+
+    virtual ~RegisterBehavior() {}
+
+    // 计算第point个点在t时刻（自仿真开始，秒）的数值；每次定时更新对每个点调用一次
+    virtual double valueAt(double t, int point) = 0;
+
+    // 按JSON配置创建行为，type为ramp/sine/randomWalk/counter/csv；配置错误时抛出cRuntimeError
+    static std::unique_ptr<RegisterBehavior> create(const nlohmann::json& j, cRNG *rng);
+};
+
+// 线性斜坡：start + slope*t，超出[min, max]后从另一端重新开始
+class RampBehavior : public RegisterBehavior
+{
+  public:
+    double start = 0, slope = 1, min = -32768, max = 65535;
+    virtual double valueAt(double t, int point) override;
+};
+
+// 正弦：offset + amplitude*sin(2π(t/period + phase))，第k个点额外相移k*phaseStep（周期的比例）
+class SineBehavior : public RegisterBehavior
+{
+  public:
+    double offset = 0, amplitude = 1000, period = 60, phase = 0, phaseStep = 0;
+    virtual double valueAt(double t, int point) override;
+};
+
+// 随机游走：每次更新在[-step, step]内均匀随机变化，限制在[min, max]内，各点独立
+class RandomWalkBehavior : public RegisterBehavior
+{
+  public:
+    double start = 0, step = 1, min = -32768, max = 65535;
+    cRNG *rng = nullptr;
+    std::vector<double> current;
+    virtual double valueAt(double t, int point) override;
+};
+
+// 计数器：每次更新增加step，超过max后回到start
+class CounterBehavior : public RegisterBehavior
+{
+  public:
+    double start = 0, step = 1, max = 65535;
+    std::vector<double> current;
+    virtual double valueAt(double t, int point) override;
+};
+
+// CSV回放：每行"时间,值1,值2,..."（可有表头），取时间不超过t的最后一行；
+// 第k个点取第column+k列（不足时取最后一列），loop为true时按最后一行时间循环
+class CsvReplayBehavior : public RegisterBehavior
+{
+  public:
+    int column = 1;
+    bool loop = true;
+    std::vector<double> times;
+    std::vector<std::vector<double>> rows;
+    size_t cursor = 0;  // 上次查找到的行，时间单调递增时从此处继续查找
+    void load(const std::string& fileName);
+    virtual double valueAt(double t, int point) override;
+};
+
+} // namespace inet
+
+#endif // __INET_MODBUSBEHAVIOR_H
@@ -0,0 +1,184 @@
+//
+// Copyright (C) 2025 llw
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+
+#ifndef __INET_MODBUSCODEC_H
+#define __INET_MODBUSCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace inet {
+
+// -----------------------------------------------------------------------------
+// Modbus报文数据区的批量编解码：寄存器按大端（高字节在前）传输；
+// 线圈/离散输入按位紧凑传输，低位在前（第i个点位于第i/8字节的第i%8位）。
+// 寄存器在小端主机上按字节对交换：启用SSSE3时每次用字节重排指令处理8个寄存器，
+// 只有SSE2时用16位移位处理8个，否则每次用64位字处理4个；位数据每次处理64位，
+// 启用SSE2时打包用字节掩码指令每次处理16个点，其余部分逐个处理。
+// -----------------------------------------------------------------------------
+
+// 交换count个寄存器（2*count字节）中每对字节的顺序，返回已处理的寄存器数（剩余部分由调用者逐个处理）。
+// 只在小端主机上处理：大端/主机序互转在小端上即字节对交换，大端主机上返回0
+inline size_t swapRegisterBytes(void* dst, const void* src, size_t count) {
+    size_t i = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+#if defined(__SSSE3__)
+    const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_shuffle_epi8(v, swap));
+    }
+#elif defined(__SSE2__)
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+    }
+#endif
+    for (; i + 4 <= count; i += 4) {
+        uint64_t word;
+        memcpy(&word, in + 2 * i, sizeof(word));
+        word = (word & 0x00FF00FF00FF00FFULL) << 8 | ((word >> 8) & 0x00FF00FF00FF00FFULL);
+        memcpy(out + 2 * i, &word, sizeof(word));
+    }
+#endif
+    return i;
+}
+
+// 将count个大端寄存器从src解码到dst（主机序int16_t）
+inline void decodeRegisters(int16_t* dst, const uint8_t* src, size_t count) {
+    size_t i = swapRegisterBytes(dst, src, count);
+    for (; i < count; i++)
+        dst[i] = int16_t(uint16_t(src[2 * i]) << 8 | src[2 * i + 1]);
+}
+
+// 将count个寄存器（主机序）按大端编码到dst（2*count字节）
+inline void encodeRegisters(uint8_t* dst, const int16_t* src, size_t count) {
+    size_t i = swapRegisterBytes(dst, src, count);
+    for (; i < count; i++) {
+        uint16_t value = uint16_t(src[i]);
+        dst[2 * i] = value >> 8;
+        dst[2 * i + 1] = value & 0xFF;
+    }
+}
+
+// 按小端读写64位字（位数据以字节为单位低位在前，小端字中第k位即第k个点）
+inline uint64_t loadBitWord(const uint8_t* src) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t word;
+    memcpy(&word, src, sizeof(word));
+    return word;
+#else
+    uint64_t word = 0;
+    for (int k = 0; k < 8; k++)
+        word |= uint64_t(src[k]) << (8 * k);
+    return word;
+#endif
+}
+
+inline void storeBitWord(uint8_t* dst, uint64_t word) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(dst, &word, sizeof(word));
+#else
+    for (int k = 0; k < 8; k++)
+        dst[k] = uint8_t(word >> (8 * k));
+#endif
+}
+
+// 将src中从第bitOffset位开始的count个点展开为每点一字节（0/1）写入dst
+inline void unpackBits(uint8_t* dst, const uint8_t* src, size_t bitOffset, size_t count) {
+    src += bitOffset / 8;
+    unsigned shift = bitOffset % 8;
+    size_t srcBytes = (shift + count + 7) / 8;
+    size_t i = 0;
+    // 每次取64位；非字节对齐时需多读一个字节，不足时交给逐位处理
+    for (; i + 64 <= count && i / 8 + 8 + (shift ? 1 : 0) <= srcBytes; i += 64) {
+        uint64_t word = loadBitWord(src + i / 8);
+        if (shift)
+            word = word >> shift | uint64_t(src[i / 8 + 8]) << (64 - shift);
+        for (int b = 0; b < 8; b++) {
+            // 将一个字节的8位分散到8个字节：第k字节只保留第k位，再归一化为0/1
+            uint64_t spread = (uint64_t((word >> (8 * b)) & 0xFF) * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+            spread = ((spread + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+            storeBitWord(dst + i + 8 * b, spread);
+        }
+    }
+    for (; i < count; i++)
+        dst[i] = (src[(shift + i) / 8] >> ((shift + i) % 8)) & 0x01;
+}
+
+// 将count个点（每点一字节，非0为1）打包写入dst，共(count+7)/8字节，末字节高位补0
+inline void packBits(uint8_t* dst, const uint8_t* src, size_t count) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & 0xFFFF;  // 第k位对应第k个点是否非0
+        dst[i / 8] = uint8_t(mask);
+        dst[i / 8 + 1] = uint8_t(mask >> 8);
+    }
+#endif
+    for (; i + 64 <= count; i += 64) {
+        for (int b = 0; b < 8; b++) {
+            uint64_t word = loadBitWord(src + i + 8 * b);
+            // 各字节归一化为0/1后，用乘法把第k字节的最低位汇集到最高字节的第k位
+            word = ((word | ((word & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL)) >> 7) & 0x0101010101010101ULL;
+            dst[i / 8 + b] = uint8_t((word * 0x0102040810204080ULL) >> 56);
+        }
+    }
+    if (i < count)
+        memset(dst + i / 8, 0, (count - i + 7) / 8);
+    for (; i < count; i++) {
+        if (src[i])
+            dst[i / 8] |= uint8_t(1u << (i % 8));
+    }
+}
+
+// 将src中从第srcOffset位开始的count位复制到dst第dstOffset位开始处（均为低位在前），dst其余位保持不变
+inline void copyBits(uint8_t* dst, size_t dstOffset, const uint8_t* src, size_t srcOffset, size_t count) {
+    dst += dstOffset / 8;
+    dstOffset %= 8;
+    src += srcOffset / 8;
+    srcOffset %= 8;
+    size_t i = 0;
+    if (dstOffset == 0 && srcOffset == 0) {
+        // 两侧都字节对齐：整字节直接复制
+        if (count >= 8)
+            memcpy(dst, src, count / 8);
+        i = count / 8 * 8;
+    }
+    else {
+        // 先逐位写到目标字节对齐，之后每次由源的一到两个字节移位拼出一个完整字节
+        for (; i < count && (dstOffset + i) % 8 != 0; i++) {
+            size_t sb = srcOffset + i, db = dstOffset + i;
+            dst[db / 8] = (dst[db / 8] & ~(1u << (db % 8))) | (((src[sb / 8] >> (sb % 8)) & 0x01) << (db % 8));
+        }
+        for (; i + 8 <= count; i += 8) {
+            size_t sb = srcOffset + i;
+            unsigned shift = sb % 8;
+            uint8_t byte = src[sb / 8] >> shift;
+            if (shift)
+                byte |= src[sb / 8 + 1] << (8 - shift);
+            dst[(dstOffset + i) / 8] = byte;
+        }
+    }
+    for (; i < count; i++) {
+        size_t sb = srcOffset + i, db = dstOffset + i;
+        dst[db / 8] = (dst[db / 8] & ~(1u << (db % 8))) | (((src[sb / 8] >> (sb % 8)) & 0x01) << (db % 8));
+    }
+}
+
+} // namespace inet
+
+#endif // __INET_MODBUSCODEC_H
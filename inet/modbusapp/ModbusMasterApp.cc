@@ -1,4 +1,7 @@
 #include "ModbusMasterApp.h"
+#include <algorithm>
+#include <random>
+#include "ModbusCodec.h"
 #include "TransitApp.h"
 #include "inet/common/ProtocolTag_m.h"
 #include "inet/common/packet/chunk/ByteCountChunk.h"
@@ -11,15 +14,69 @@ namespace inet {
 
 Define_Module(ModbusMasterApp);
 
+simsignal_t ModbusMasterApp::requestTimeoutSignal = registerSignal("requestTimeout");
+simsignal_t ModbusMasterApp::requestRetrySignal = registerSignal("requestRetry");
+simsignal_t ModbusMasterApp::quarantinedSlavesSignal = registerSignal("quarantinedSlaves");
+simsignal_t ModbusMasterApp::operatorLatencySignal = registerSignal("operatorLatency");
+simsignal_t ModbusMasterApp::pollLatencySignal = registerSignal("pollLatency");
+simsignal_t ModbusMasterApp::pollOverrunSignal = registerSignal("pollOverrun");
+simsignal_t ModbusMasterApp::pollScaleSignal = registerSignal("pollScale");
+simsignal_t ModbusMasterApp::pollCycleTimeSignal = registerSignal("pollCycleTime");
+simsignal_t ModbusMasterApp::storageChangedSignal = registerSignal("storageChanged");
+
 void ModbusMasterApp::initialize(int stage) {
     ModbusTcpAppBase::initialize(stage);
     if (stage == INITSTAGE_APPLICATION_LAYER) {
         // 从NED参数获取读取间隔
         readInterval = par("readInterval");
+        if (readInterval <= SIMTIME_ZERO)
+            throw cRuntimeError("readInterval must be positive");
+        maxOutstandingPerConnection = par("maxOutstandingPerConnection");
+        if (maxOutstandingPerConnection < 1)
+            throw cRuntimeError("maxOutstandingPerConnection must be at least 1");
+        responseTimeout = par("responseTimeout");
+        maxRetries = par("maxRetries");
+        quarantineBackoff = par("quarantineBackoff");
+        maxQuarantineBackoff = par("maxQuarantineBackoff");
+        timeoutWheel.setup(par("timeoutResolution"), par("timeoutWheelSlots"));
+        coalesceReads = par("coalesceReads");
+        coalesceGap = par("coalesceGap");
+        if (coalesceGap < 0)
+            throw cRuntimeError("coalesceGap must not be negative");
+        const char *laneScheduling = par("laneScheduling");
+        if (!strcmp(laneScheduling, "strict"))
+            weightedLanes = false;
+        else if (!strcmp(laneScheduling, "weighted"))
+            weightedLanes = true;
+        else
+            throw cRuntimeError("Unknown laneScheduling '%s', expected 'strict' or 'weighted'", laneScheduling);
+        operatorLaneWeight = par("operatorLaneWeight");
+        if (operatorLaneWeight < 1)
+            throw cRuntimeError("operatorLaneWeight must be at least 1");
+        const char *staggerMode = par("pollStagger");
+        if (!strcmp(staggerMode, "none"))
+            pollStagger = STAGGER_NONE;
+        else if (!strcmp(staggerMode, "even"))
+            pollStagger = STAGGER_EVEN;
+        else if (!strcmp(staggerMode, "random"))
+            pollStagger = STAGGER_RANDOM;
+        else
+            throw cRuntimeError("Unknown pollStagger '%s', expected 'none', 'even' or 'random'", staggerMode);
+        staggerSeed = par("staggerSeed");
+        adaptivePolling = par("adaptivePolling");
+        minPollScale = par("minPollScale");
+        maxPollScale = par("maxPollScale");
+        targetUtilization = par("targetUtilization");
+        if (minPollScale <= 0 || maxPollScale < minPollScale)
+            throw cRuntimeError("Invalid poll scale bounds: require 0 < minPollScale <= maxPollScale");
+        if (targetUtilization <= 0 || targetUtilization > 1)
+            throw cRuntimeError("targetUtilization must be in (0, 1]");
         readTimer = new cMessage("readTimer");
         sendNextTimer = new cMessage("sendNextTimer");
+        timeoutTimer = new cMessage("timeoutTimer");
 
-        scheduleAt(simTime(), readTimer);
+        // 生成轮询计划并从当前时刻开始扫描
+        rebuildPollPlan();
     }
 }
 
@@ -27,208 +84,650 @@ void ModbusMasterApp::handleTimer(cMessage *msg) {
     if (msg == readTimer) {
         EV_INFO << "===== 触发读取定时器（readTimer），时间：" << simTime() << " =====" << endl;
 
-        // 生成所有查询报文并加入发送队列
-        EV_INFO << "开始生成从站查询报文，准备加入发送队列..." << endl;
-        generateQueryPacket(sendSocketQueue);
+        // 只为到期的扫描任务生成查询报文并加入发送队列
+        generateQueryPacket();
 
-        // 查找队列是否为空
-        bool isEmpty = true;
-        for (const auto& queue : sendSocketQueue) {
-            if (queue.second.getLength() > b(0)) {
-                isEmpty = false;
-                break;
+        // 若有待发送请求，立即触发发送
+        scheduleSendIfPending();
+
+        // 调度到下一个到期的扫描任务
+        scheduleNextScan();
+        EV_INFO << "===== 读取定时器处理完成 =====" << endl;
+    }
+    else if (msg == sendNextTimer) {
+        EV_INFO << "===== 触发发送定时器（sendNextTimer），时间：" << simTime() << " =====" << endl;
+        sendQueuedRequests();
+        EV_INFO << "===== 发送定时器处理完成 =====" << endl;
+    }
+    else if (msg == timeoutTimer) {
+        handleTimeouts();
+    }
+    else {
+        EV_INFO << "处理未知定时器：" << msg->getName() << "，转发给父类处理" << endl;
+        ModbusTcpAppBase::handleTimer(msg);
+    }
+}
+
+void ModbusMasterApp::sendQueuedRequests() {
+    // 各连接独立出队：只要该连接的在途事务数未达到窗口上限，就继续发送
+    for (int connIdx = 0; connIdx < modbusStorage.getNumConnect(); connIdx++) {
+        int socketId = modbusStorage.getConnect(connIdx).socketId;
+        auto it = sendQueues.find(socketId);
+        if (it == sendQueues.end())
+            continue;
+        SendLanes& lanes = it->second;
+
+        auto socket = socketMap.getSocketById(socketId);
+        if (!socket) {
+            // 连接已不存在：排队的请求无法发送，丢弃以免轮询条目一直处于排队状态
+            EV_ERROR << "socketId=" << socketId << " 对应的socket不存在，丢弃其排队的请求" << endl;
+            dropQueuedRequests(socketId);
+            continue;
+        }
+
+        int& inflight = numInflight[socketId];
+        QueuedRequest request;
+        while (inflight < maxOutstandingPerConnection && dequeueRequest(lanes, request)) {
+            if (request.planIndex >= 0)
+                readQueued[connIdx][request.planIndex] = false;
+
+            uint16_t tid = request.transactionId;
+            uint64_t key = transactionKey(socketId, tid);
+            if (!request.transit && isSlaveQuarantined(socketId, request.slaveId)) {
+                // 隔离期内的从站不参与轮询，丢弃其排队的请求（中转请求仍然发送）
+                EV_INFO << "从站ID=" << (int)request.slaveId << " 处于隔离期，丢弃事务ID=" << tid << " 的请求" << endl;
+                completePollRequest(request.taskIndex);
+                continue;
+            }
+            if (pendingTransactions.count(key)) {
+                // 事务ID回绕后与仍在途的请求冲突，无法按事务ID区分响应；
+                // 轮询请求直接丢弃，中转请求须回送异常，避免TransitApp一直等不到响应
+                EV_WARN << "socketId=" << socketId << " 事务ID=" << tid << " 仍在途，丢弃重复事务ID的请求" << endl;
+                completePollRequest(request.taskIndex);
+                if (request.transit)
+                    sendTransitException(tid, request.slaveId, request.pdu);
+                continue;
             }
+
+            // 发送时才生成MBAP头部，PDU直接复用
+            auto requestHeader = makeShared<ModbusHeader>();
+            requestHeader->setTransactionId(tid);
+            requestHeader->setProtocolId(0x0000);
+            requestHeader->setLength(1 /*slaveId*/ + B(request.pdu->getChunkLength()).get());
+            requestHeader->setSlaveId(request.slaveId);
+            requestHeader->addTag<CreationTimeTag>()->setCreationTime(request.enqueueTime);
+            requestHeader->markImmutable();
+
+            PendingTransaction& transaction = pendingTransactions[key];
+            transaction.socketId = socketId;
+            transaction.header = requestHeader;
+            transaction.pdu = request.pdu;
+            transaction.enqueueTime = request.enqueueTime;
+            transaction.sendTime = simTime();
+            transaction.transit = request.transit;
+            transaction.taskIndex = request.taskIndex;
+            armTimeout(key, transaction);
+            inflight++;
+
+            // 封装为Packet并发送
+            auto pkt = new Packet("ModbusQuery");
+            pkt->insertAtFront(requestHeader);
+            pkt->insertAtBack(request.pdu);
+            pkt->addTag<CreationTimeTag>()->setCreationTime(request.enqueueTime);
+
+            EV_INFO << "发送Modbus请求：事务ID=" << tid
+                    << "，从站ID=" << (int)request.slaveId
+                    << "，数据长度=" << pkt->getTotalLength()
+                    << "，目标socketId=" << socketId
+                    << "，在途事务数=" << inflight << endl;
+
+            sendPacket(pkt, check_and_cast<TcpSocket*>(socket));
         }
+    }
+}
+
+void ModbusMasterApp::enqueueRequest(int socketId, const QueuedRequest& request) {
+    auto it = sendQueues.find(socketId);
+    if (it == sendQueues.end()) {
+        // 新建车道时运维车道先拿到完整额度，首次争用由运维请求优先发送
+        it = sendQueues.emplace(socketId, SendLanes()).first;
+        it->second.operatorCredit = operatorLaneWeight;
+    }
+    it->second.lane[request.transit ? LANE_OPERATOR : LANE_CYCLIC].push_back(request);
+}
 
-        if (isEmpty) {
-            EV_INFO << "所有发送队列均为空，无需发送数据" << endl;
-        }else{
-            scheduleAt(simTime(), sendNextTimer); // 立即触发第一个发送
+void ModbusMasterApp::dropQueuedRequests(int socketId) {
+    auto it = sendQueues.find(socketId);
+    if (it == sendQueues.end())
+        return;
+    int connIdx = modbusStorage.findConnectIndexBySocketId(socketId);
+    for (auto& lane : it->second.lane) {
+        for (const QueuedRequest& request : lane) {
+            if (request.planIndex >= 0 && connIdx >= 0 && connIdx < (int)readQueued.size())
+                readQueued[connIdx][request.planIndex] = false;
+            completePollRequest(request.taskIndex);
+            if (request.transit)
+                sendTransitException(request.transactionId, request.slaveId, request.pdu);
         }
+    }
+    sendQueues.erase(it);
+}
 
+void ModbusMasterApp::dropConnection(int socketId) {
+    dropQueuedRequests(socketId);
 
+    // 在途事务不再等待超时轮：直接结束，时间轮中残留的条目在到期时被惰性忽略
+    for (auto it = pendingTransactions.begin(); it != pendingTransactions.end(); ) {
+        if (it->second.socketId != socketId) {
+            ++it;
+            continue;
+        }
+        PendingTransaction failed = it->second;
+        it = pendingTransactions.erase(it);
+        completePollRequest(failed.taskIndex);
+        if (failed.transit)
+            sendTransitException(failed.header->getTransactionId(), failed.header->getSlaveId(), failed.pdu);
+    }
+    numInflight.erase(socketId);
+    socketQueue.erase(socketId);
+}
 
-        // 调度下一轮读取周期
-        scheduleAt(simTime() + readInterval, readTimer);
-        EV_INFO << "已调度下一次读取定时器，间隔：" << readInterval
-                << "，下次执行时间：" << simTime() + readInterval << endl;
-        EV_INFO << "===== 读取定时器处理完成 =====" << endl;
+bool ModbusMasterApp::dequeueRequest(SendLanes& lanes, QueuedRequest& request) {
+    bool hasOperator = !lanes.lane[LANE_OPERATOR].empty();
+    bool hasCyclic = !lanes.lane[LANE_CYCLIC].empty();
+    if (!hasOperator && !hasCyclic)
+        return false;
+
+    RequestLane selected;
+    if (!hasCyclic)
+        selected = LANE_OPERATOR;
+    else if (!hasOperator)
+        selected = LANE_CYCLIC;
+    else if (!weightedLanes)
+        selected = LANE_OPERATOR;  // 严格优先：只要有运维请求就先发送
+    else if (lanes.operatorCredit > 0) {
+        // 加权轮转：运维车道连续发送operatorLaneWeight条后让出一次，保证轮询不被饿死
+        selected = LANE_OPERATOR;
+        lanes.operatorCredit--;
+    }
+    else {
+        selected = LANE_CYCLIC;
+        lanes.operatorCredit = operatorLaneWeight;
+    }
 
+    request = lanes.lane[selected].front();
+    lanes.lane[selected].pop_front();
+    return true;
+}
 
+void ModbusMasterApp::scheduleSendIfPending() {
+    bool isEmpty = true;
+    for (const auto& queue : sendQueues) {
+        if (!queue.second.empty()) {
+            isEmpty = false;
+            break;
+        }
     }
-    else if (msg == sendNextTimer) {
-        EV_INFO << "===== 触发发送定时器（sendNextTimer），时间：" << simTime() << " =====" << endl;
 
-//        // 查找第一个非空的发送队列
-//        int socketId = -1;
-//        for (const auto& queue : sendSocketQueue) {
-//            if (queue.second.getLength() > b(0)) {
-//                socketId = queue.first;
-//                EV_INFO << "找到非空发送队列，socketId=" << socketId
-//                        << "，剩余数据长度=" << queue.second.getLength() << endl;
-//                break;
-//            }
-//        }
-//
-//        if (socketId == -1) {
-//            EV_INFO << "所有发送队列均为空，无需发送数据" << endl;
-//            EV_INFO << "===== 发送定时器处理完成 =====" << endl;
-//            return;
-//        }
-//
-//        // 获取对应的socket
-//        auto socket = socketMap.getSocketById(socketId);
-//        if (!socket) {
-//            EV_ERROR << "socketId=" << socketId << " 对应的socket不存在，无法发送数据" << endl;
-//            EV_INFO << "===== 发送定时器处理完成 =====" << endl;
-//            return;
-//        }
-//
-//        // 提取并发送队列中的请求报文
-//        if (!sendSocketQueue[socketId].has<ModbusHeader>()) {
-//            EV_WARN << "socketId=" << socketId << " 的发送队列中没有完整的Modbus头部，无法发送" << endl;
-//            EV_INFO << "===== 发送定时器处理完成 =====" << endl;
-//            return;
-//        }
-//
-//        // 从队列中弹出请求头部和PDU
-//        const auto& requestHeader = sendSocketQueue[socketId].pop<ModbusHeader>();
-//        B pduLength = B(requestHeader->getLength() - 1); // 减去slaveId的1字节
-//        const auto& requestPdu = sendSocketQueue[socketId].pop<BytesChunk>(pduLength);
-//
-//        // 封装为Packet并发送
-//        auto pkt = new Packet("ModbusQuery");
-//        pkt->insertAtFront(requestHeader);
-//        pkt->insertAtBack(requestPdu);
-//
-//        EV_INFO << "发送Modbus请求：事务ID=" << requestHeader->getTransactionId()
-//                << "，从站ID=" << (int)requestHeader->getSlaveId()
-//                << "，数据长度=" << pkt->getTotalLength()
-//                << "，目标socketId=" << socketId << endl;
-//
-//        sendPacket(pkt, check_and_cast<TcpSocket*>(socket));
-
-//        // 检查队列是否还有剩余数据，有则继续调度下一次发送
-//        if (sendSocketQueue[socketId].getLength() > b(0)) {
-//            scheduleAt(simTime(), sendNextTimer); // 立即发送下一个（可根据需要调整间隔）
-//            EV_INFO << "socketId=" << socketId << " 的发送队列仍有剩余数据，已调度下一次发送" << endl;
-//        } else {
-//            EV_INFO << "socketId=" << socketId << " 的发送队列已清空，暂不调度下一次发送" << endl;
-//        }
-
-
-        if(connectIndex < 0){
-            throw cRuntimeError("connectIndex 不能小于0");
+    if (isEmpty) {
+        EV_INFO << "所有发送队列均为空，无需发送数据" << endl;
+    }
+    else if (!sendNextTimer->isScheduled()) {
+        scheduleAt(simTime(), sendNextTimer); // 立即触发发送
+    }
+}
+
+void ModbusMasterApp::armTimeout(uint64_t key, PendingTransaction& transaction) {
+    if (responseTimeout <= SIMTIME_ZERO)
+        return;
+    if (timeoutWheel.empty() && !timeoutTimer->isScheduled())
+        timeoutWheel.reset(simTime());
+    transaction.deadline = simTime() + responseTimeout;
+    timeoutWheel.insert(key, transaction.deadline);
+    if (!timeoutTimer->isScheduled())
+        scheduleAt(timeoutWheel.getNextTickTime(), timeoutTimer);
+}
+
+void ModbusMasterApp::handleTimeouts() {
+    std::vector<TimerWheel<uint64_t>::Entry> expired;
+    timeoutWheel.advance(simTime(), expired);
+
+    for (const auto& entry : expired) {
+        auto it = pendingTransactions.find(entry.key);
+        // 惰性取消：已收到响应或已重发（截止时间已更新）的条目直接忽略
+        if (it == pendingTransactions.end() || it->second.deadline != entry.deadline)
+            continue;
+        PendingTransaction& transaction = it->second;
+        emit(requestTimeoutSignal, 1L);
+        EV_WARN << "请求超时：socketId=" << transaction.socketId
+                << "，事务ID=" << transaction.header->getTransactionId()
+                << "，从站ID=" << (int)transaction.header->getSlaveId()
+                << "，已重发" << transaction.retries << "次" << endl;
+
+        auto socket = socketMap.getSocketById(transaction.socketId);
+        if (socket && transaction.retries < maxRetries) {
+            // 以相同事务ID重发
+            transaction.retries++;
+            transaction.sendTime = simTime();
+            armTimeout(entry.key, transaction);
+            emit(requestRetrySignal, 1L);
+
+            auto pkt = new Packet("ModbusQuery");
+            pkt->insertAtFront(transaction.header);
+            pkt->insertAtBack(transaction.pdu);
+            sendPacket(pkt, check_and_cast<TcpSocket*>(socket));
         }
-        if(connectIndex >= modbusStorage.getNumConnect()){
-            connectIndex = connectIndex % modbusStorage.getNumConnect();
+        else {
+            PendingTransaction failed = transaction;
+            pendingTransactions.erase(it);
+            numInflight[failed.socketId]--;
+            handleTransactionFailure(failed);
         }
-        auto connect = modbusStorage.getConnect(connectIndex);
+    }
 
-        // 获取对应的socket
-       auto socket = socketMap.getSocketById(connect.socketId);
-        if (!socket) {
-            EV_ERROR << "socketId=" << connect.socketId << " 对应的socket不存在，无法发送数据" << endl;
-            EV_INFO << "===== 发送定时器处理完成 =====" << endl;
-            return;
-        }
+    // 释放的窗口可发送后续请求
+    scheduleSendIfPending();
+    if (!timeoutWheel.empty() && !timeoutTimer->isScheduled())
+        scheduleAt(timeoutWheel.getNextTickTime(), timeoutTimer);
+}
 
-        // 提取并发送队列中的请求报文
-        if (!sendSocketQueue[connect.socketId].has<ModbusHeader>()) {
-            EV_INFO << "socketId=" << connect.socketId << " 的发送队列中没有完整的Modbus头部，无法发送" << endl;
-            connectIndex++;
-            scheduleAt(simTime(), sendNextTimer);
-            EV_INFO << "===== 发送定时器处理完成 =====" << endl;
-            return;
+void ModbusMasterApp::handleTransactionFailure(const PendingTransaction& transaction) {
+    uint8_t slaveId = transaction.header->getSlaveId();
+    recordSlaveFailure(transaction.socketId, slaveId);
+    completePollRequest(transaction.taskIndex);
+
+    // 中转请求最终失败：回送网关目标无响应异常
+    if (transaction.transit)
+        sendTransitException(transaction.header->getTransactionId(), slaveId, transaction.pdu);
+}
+
+void ModbusMasterApp::sendTransitException(uint16_t transactionId, uint8_t slaveId, const Ptr<const BytesChunk>& pdu) {
+    const auto& pduBytes = pdu->getBytes();
+    uint8_t functionCode = pduBytes.empty() ? 0 : pduBytes[0];
+    auto exceptionHeader = makeShared<ModbusHeader>();
+    exceptionHeader->setTransactionId(transactionId);
+    exceptionHeader->setProtocolId(0);
+    exceptionHeader->setLength(3);
+    exceptionHeader->setSlaveId(slaveId);
+    auto exceptionPdu = makeShared<BytesChunk>();
+    exceptionPdu->setBytes({uint8_t(functionCode | 0x80), uint8_t(0x0B)});
+
+    auto transitResponse = new Packet("transitResponse", TCP_C_SEND);
+    transitResponse->insertAtFront(exceptionHeader);
+    transitResponse->insertAtBack(exceptionPdu);
+    transitResponse->addTag<CreationTimeTag>()->setCreationTime(simTime());
+    TransitApp *transitApp = check_and_cast<TransitApp*>(findModuleByPath("^.app[2]"));
+    transitApp->sendBack(transitResponse);
+}
+
+void ModbusMasterApp::recordSlaveFailure(int socketId, uint8_t slaveId) {
+    if (quarantineBackoff <= SIMTIME_ZERO)
+        return;
+    SlaveHealth& health = slaveHealth[{socketId, slaveId}];
+    if (health.quarantined && simTime() < health.quarantinedUntil)
+        return;  // 隔离期内仍在途请求的失败不重复计数
+    health.consecutiveFailures++;
+
+    // 指数退避：quarantineBackoff * 2^(失败次数-1)，不超过上限
+    simtime_t backoff = quarantineBackoff;
+    for (int i = 1; i < health.consecutiveFailures && backoff < maxQuarantineBackoff; i++)
+        backoff *= 2;
+    if (backoff > maxQuarantineBackoff)
+        backoff = maxQuarantineBackoff;
+    health.quarantinedUntil = simTime() + backoff;
+
+    if (!health.quarantined) {
+        health.quarantined = true;
+        numQuarantinedSlaves++;
+        emit(quarantinedSlavesSignal, numQuarantinedSlaves);
+    }
+    EV_WARN << "从站无响应，隔离：socketId=" << socketId << "，从站ID=" << (int)slaveId
+            << "，连续失败" << health.consecutiveFailures << "次，隔离至" << health.quarantinedUntil << endl;
+}
+
+void ModbusMasterApp::recordSlaveSuccess(int socketId, uint8_t slaveId) {
+    auto it = slaveHealth.find({socketId, slaveId});
+    if (it == slaveHealth.end())
+        return;
+    it->second.consecutiveFailures = 0;
+    if (it->second.quarantined) {
+        it->second.quarantined = false;
+        numQuarantinedSlaves--;
+        emit(quarantinedSlavesSignal, numQuarantinedSlaves);
+    }
+}
+
+bool ModbusMasterApp::isSlaveQuarantined(int socketId, uint8_t slaveId) {
+    auto it = slaveHealth.find({socketId, slaveId});
+    if (it == slaveHealth.end() || !it->second.quarantined)
+        return false;
+    if (simTime() < it->second.quarantinedUntil)
+        return true;
+    // 隔离期满，重新加入轮询（失败计数保留，再次失败时退避时间加倍）
+    it->second.quarantined = false;
+    numQuarantinedSlaves--;
+    emit(quarantinedSlavesSignal, numQuarantinedSlaves);
+    return false;
+}
+
+void ModbusMasterApp::generateQueryPacket() {
+    EV_INFO << "===== 开始生成所有从站查询报文并加入发送队列 =====" << endl;
+    int totalRequestsGenerated = 0;  // 统计生成的请求总数
+
+    // 依次弹出所有已到期的扫描任务，按计划生成请求后以新的到期时间重新入堆
+    while (!scanQueue.empty() && scanQueue.top().first <= simTime()) {
+        int taskIdx = scanQueue.top().second;
+        scanQueue.pop();
+        ScanTask& task = scanTasks[taskIdx];
+
+        const auto& conn = modbusStorage.getConnect(task.connIdx);
+        EV_INFO << "处理连接 [" << task.connIdx << "]，socketId=" << conn.socketId
+                << "，扫描周期=" << task.interval << "，读请求数=" << task.reads.size() << endl;
+        // 上一周期的请求尚未全部完成：本周期超期，周期继续累计，不重复入队仍在排队的请求
+        bool overrun = task.outstanding > 0;
+        if (overrun) {
+            numPollOverruns++;
+            emit(pollOverrunSignal, 1L);
+            EV_WARN << "连接 [" << task.connIdx << "] 扫描周期" << task.interval << "超期，上一周期仍有 "
+                    << task.outstanding << " 条请求未完成" << endl;
         }
+        else {
+            task.cycleStart = simTime();
+        }
+        adaptPollRate(taskIdx, overrun);
 
-        // 从队列中弹出请求头部和PDU
-        const auto& tempHeader = sendSocketQueue[connect.socketId].peek<ModbusHeader>();
-        if(tempHeader->getTransactionId() != pretransactionId + 1){
-            connectIndex++;
-            scheduleAt(simTime(), sendNextTimer);
-            EV_INFO << "===== 发送定时器处理完成 =====" << endl;
-            return;
+        for (int readIdx : task.reads) {
+            const PollRead& read = pollPlan[task.connIdx][readIdx];
+            if (isSlaveQuarantined(conn.socketId, read.slaveId)) {
+                EV_DETAIL << "  从站 slaveId=" << (int)read.slaveId << " 处于隔离期，本周期跳过" << endl;
+                continue;
+            }
+            if (readQueued[task.connIdx][readIdx]) {
+                // 同一组的读请求仍未发送：发送时读到的就是最新数据，无需再入队
+                numDedupedRequests++;
+                continue;
+            }
+            // 只分配事务ID，PDU直接引用计划中的预编码块
+            QueuedRequest request;
+            request.transactionId = transactionId++;
+            request.slaveId = read.slaveId;
+            request.pdu = read.pdu;
+            request.enqueueTime = simTime();
+            request.taskIndex = taskIdx;
+            request.planIndex = readIdx;
+            enqueueRequest(conn.socketId, request);
+            readQueued[task.connIdx][readIdx] = true;
+            task.outstanding++;
+            totalRequestsGenerated++;
         }
-        const auto& requestHeader = sendSocketQueue[connect.socketId].pop<ModbusHeader>();
-        pretransactionId++;
-        B pduLength = B(requestHeader->getLength() - 1); // 减去slaveId的1字节
-        const auto& requestPdu = sendSocketQueue[connect.socketId].pop<BytesChunk>(pduLength);
 
-        // 封装为Packet并发送
-        auto pkt = new Packet("ModbusQuery");
-        pkt->insertAtFront(requestHeader);
-        pkt->insertAtBack(requestPdu);
+        // 按固定节拍推进；若已落后超过一个周期（如停止后重启），不补发错过的周期
+        simtime_t period = task.interval * connectRate[task.connIdx].scale;
+        task.nextDue += period;
+        if (task.nextDue <= simTime())
+            task.nextDue = simTime() + period;
+        scanQueue.push(ScanDue(task.nextDue, taskIdx));
+    }
 
-        EV_INFO << "发送Modbus请求：事务ID=" << requestHeader->getTransactionId()
-                << "，从站ID=" << (int)requestHeader->getSlaveId()
-                << "，数据长度=" << pkt->getTotalLength()
-                << "，目标socketId=" << connect.socketId << endl;
+    EV_INFO << "===== 到期查询报文生成完成，共生成 " << totalRequestsGenerated << " 条请求 =====" << endl;
 
-        sendPacket(pkt, check_and_cast<TcpSocket*>(socket));
+}
 
-        EV_INFO << "===== 发送定时器处理完成 =====" << endl;
+void ModbusMasterApp::adaptPollRate(int taskIdx, bool overrun) {
+    if (!adaptivePolling)
+        return;
+    const ScanTask& task = scanTasks[taskIdx];
+    ConnectionRate& rate = connectRate[task.connIdx];
+
+    // 伸缩系数按连接共享：各扫描任务只累计超期，由周期最短的任务每周期统一调整一次，
+    // 避免同一周期内多个任务重复放大或互相抵消
+    rate.overrunSeen = rate.overrunSeen || overrun;
+    if (taskIdx != rate.pacingTask)
+        return;
+    overrun = rate.overrunSeen;
+    rate.overrunSeen = false;
+
+    // 以平滑RTT估算完成一轮计划所需时间：请求速率 * RTT / 窗口 为连接占用率，按期望占用率换算伸缩系数
+    double scale = minPollScale;
+    if (rate.hasRtt)
+        scale = rate.srtt.dbl() * rate.requestRate / maxOutstandingPerConnection / targetUtilization;
+    if (overrun)
+        scale = std::max(scale, rate.scale * 1.5);  // 出现积压时至少放慢50%，尽快排空
+    scale = std::min(std::max(scale, minPollScale), maxPollScale);
+    if (scale != rate.scale) {
+        rate.scale = scale;
+        emit(pollScaleSignal, scale);
+        EV_INFO << "连接 [" << task.connIdx << "] 轮询周期伸缩系数调整为 " << scale
+                << "（平滑RTT=" << rate.srtt << "，超期=" << overrun << "）" << endl;
     }
-    else {
-        EV_INFO << "处理未知定时器：" << msg->getName() << "，转发给父类处理" << endl;
-        ModbusTcpAppBase::handleTimer(msg);
+}
+
+void ModbusMasterApp::completePollRequest(int taskIndex) {
+    if (taskIndex < 0 || taskIndex >= (int)scanTasks.size())
+        return;
+    ScanTask& task = scanTasks[taskIndex];
+    if (task.outstanding > 0 && --task.outstanding == 0) {
+        numPollCycles++;
+        emit(pollCycleTimeSignal, simTime() - task.cycleStart);
     }
 }
 
-void ModbusMasterApp::generateQueryPacket(std::map<int, ChunkQueue>& sendSocketQueue) {
-    EV_INFO << "===== 开始生成所有从站查询报文并加入发送队列 =====" << endl;
-    int totalRequestsGenerated = 0;  // 统计生成的请求总数
+void ModbusMasterApp::resetPollProgress() {
+    for (auto& task : scanTasks)
+        task.outstanding = 0;
+    readQueued.resize(pollPlan.size());
+    for (int connIdx = 0; connIdx < (int)pollPlan.size(); connIdx++)
+        readQueued[connIdx].assign(pollPlan[connIdx].size(), false);
+}
+
+void ModbusMasterApp::updateRtt(int socketId, simtime_t rtt) {
+    int connIdx = modbusStorage.findConnectIndexBySocketId(socketId);
+    if (connIdx < 0 || connIdx >= (int)connectRate.size())
+        return;
+    ConnectionRate& rate = connectRate[connIdx];
+    // 与TCP相同的指数加权平均（alpha = 1/8）
+    rate.srtt = rate.hasRtt ? (rate.srtt * 7 + rtt) / 8 : rtt;
+    rate.hasRtt = true;
+}
+
+void ModbusMasterApp::computeConnectPhases() {
+    int numConnect = modbusStorage.getNumConnect();
+    connectPhase.assign(numConnect, 0.0);
+    if (pollStagger == STAGGER_EVEN) {
+        // 均匀错开：第i个连接从周期的 i/numConnect 处开始
+        for (int i = 0; i < numConnect; i++)
+            connectPhase[i] = double(i) / numConnect;
+    }
+    else if (pollStagger == STAGGER_RANDOM) {
+        // 伪随机错开：使用独立的固定种子生成器，结果与仿真RNG的使用情况无关，可复现
+        std::mt19937 generator(staggerSeed);
+        std::uniform_real_distribution<double> phase(0.0, 1.0);
+        for (int i = 0; i < numConnect; i++)
+            connectPhase[i] = phase(generator);
+    }
+}
+
+void ModbusMasterApp::restartScanSchedule(simtime_t start) {
+    scanQueue = decltype(scanQueue)();
+    for (int i = 0; i < (int)scanTasks.size(); i++) {
+        // 每个扫描任务的首次到期时间按所属连接的相位偏移其自身周期的一部分
+        int connIdx = scanTasks[i].connIdx;
+        double phase = connIdx < (int)connectPhase.size() ? connectPhase[connIdx] : 0.0;
+        scanTasks[i].nextDue = start + scanTasks[i].interval * phase;
+        scanQueue.push(ScanDue(scanTasks[i].nextDue, i));
+    }
+}
+
+void ModbusMasterApp::scheduleNextScan() {
+    if (!readTimer)
+        return;
+    if (readTimer->isScheduled())
+        cancelEvent(readTimer);
+    if (!scanQueue.empty()) {
+        scheduleAt(std::max(simTime(), scanQueue.top().first), readTimer);
+        EV_INFO << "已调度下一次读取定时器，下次执行时间：" << readTimer->getArrivalTime() << endl;
+    }
+}
+
+void ModbusMasterApp::rebuildPollPlan() {
+    Enter_Method("rebuildPollPlan");
+    pollPlan.assign(modbusStorage.getNumConnect(), std::vector<PollRead>());
+    int numGroups = 0;
+    int numReads = 0;
 
-    // 遍历所有连接
     for (int connIdx = 0; connIdx < modbusStorage.getNumConnect(); connIdx++) {
         const auto& conn = modbusStorage.getConnect(connIdx);
-        EV_INFO << "处理连接 [" << connIdx << "]，socketId=" << conn.socketId << endl;
-
-        // 遍历连接下的所有从站
+        auto& plan = pollPlan[connIdx];
         for (int slaveIdx = 0; slaveIdx < conn.numSlave; slaveIdx++) {
             const auto& slave = conn.slaves[slaveIdx];
-            EV_INFO << "  处理从站 [" << slaveIdx << "]，slaveId=" << (int)slave.slaveId << endl;
-
-            // 读取线圈组（功能码0x01）
-            for (int i = 0; i < slave.numBitGroup; i++) {
-                auto& group = slave.bitGroup[i];
-                auto pkt = createRequest(slave.slaveId, 0x01,
-                                         group.startAddress, group.number);
-                addPacketToQueue(pkt, conn.socketId);
-                // ownership of pkt is taken and it is deleted inside addPacketToQueue
-            }
+            // 扫描周期优先级：寄存器组 > 从站 > 全局readInterval
+            simtime_t slaveInterval = slave.scanInterval > 0 ? SimTime(slave.scanInterval) : readInterval;
+            // Modbus单次读取上限：线圈/离散输入2000点，寄存器125个
+            planGroupReads(plan, slave.slaveId, 0x01, slave.bitGroup, slave.numBitGroup, 2000, slaveInterval);
+            planGroupReads(plan, slave.slaveId, 0x02, slave.inputBitGroup, slave.numInputBitGroup, 2000, slaveInterval);
+            planGroupReads(plan, slave.slaveId, 0x03, slave.registerGroup, slave.numRegisterGroup, 125, slaveInterval);
+            planGroupReads(plan, slave.slaveId, 0x04, slave.inputRegisterGroup, slave.numInputRegisterGroup, 125, slaveInterval);
+            numGroups += slave.numBitGroup + slave.numInputBitGroup + slave.numRegisterGroup + slave.numInputRegisterGroup;
+        }
+        numReads += plan.size();
+    }
 
-            // 读取离散输入组（功能码0x02）
-            for (int i = 0; i < slave.numInputBitGroup; i++) {
-                auto& group = slave.inputBitGroup[i];
-                auto pkt = createRequest(slave.slaveId, 0x02,
-                                         group.startAddress, group.number);
-                addPacketToQueue(pkt, conn.socketId);
-                // ownership moved to addPacketToQueue
+    // 按(连接, 扫描周期)划分扫描任务
+    scanTasks.clear();
+    for (int connIdx = 0; connIdx < (int)pollPlan.size(); connIdx++) {
+        std::map<simtime_t, int> taskByInterval;
+        for (int readIdx = 0; readIdx < (int)pollPlan[connIdx].size(); readIdx++) {
+            simtime_t interval = pollPlan[connIdx][readIdx].scanInterval;
+            auto it = taskByInterval.find(interval);
+            if (it == taskByInterval.end()) {
+                it = taskByInterval.insert({interval, (int)scanTasks.size()}).first;
+                ScanTask task;
+                task.connIdx = connIdx;
+                task.interval = interval;
+                scanTasks.push_back(task);
             }
+            scanTasks[it->second].reads.push_back(readIdx);
+        }
+    }
+    // 旧计划的下标已失效：丢弃尚未发送的轮询请求，在途请求不再计入周期统计
+    for (auto& queue : sendQueues)
+        queue.second.lane[LANE_CYCLIC].clear();
+    for (auto& transaction : pendingTransactions)
+        transaction.second.taskIndex = -1;
+    resetPollProgress();
+
+    // 各连接按基准周期的计划请求速率（自适应轮询使用），保留已测得的RTT
+    connectRate.resize(pollPlan.size());
+    for (auto& rate : connectRate) {
+        rate.requestRate = 0;
+        rate.scale = adaptivePolling ? minPollScale : 1;
+        rate.pacingTask = -1;
+        rate.overrunSeen = false;
+    }
+    for (int taskIdx = 0; taskIdx < (int)scanTasks.size(); taskIdx++) {
+        const ScanTask& task = scanTasks[taskIdx];
+        ConnectionRate& rate = connectRate[task.connIdx];
+        rate.requestRate += task.reads.size() / task.interval.dbl();
+        if (rate.pacingTask < 0 || task.interval < scanTasks[rate.pacingTask].interval)
+            rate.pacingTask = taskIdx;
+    }
+
+    computeConnectPhases();
+    restartScanSchedule(simTime());
+    scheduleNextScan();
+
+    EV_INFO << "轮询计划已生成：" << numGroups << " 个寄存器组 -> " << numReads << " 条读请求，"
+            << scanTasks.size() << " 个扫描任务"
+            << (coalesceReads ? "（已合并，允许空洞=" + std::to_string(coalesceGap) + "）" : "") << endl;
+}
+
+template <typename ElementType>
+void ModbusMasterApp::planGroupReads(std::vector<PollRead>& plan, uint8_t slaveId, uint8_t functionCode,
+                                     const RegisterGroup<ElementType>* groups, int numGroups, int maxQuantity, simtime_t defaultInterval) const {
+    if (!groups || numGroups <= 0)
+        return;
+
+    // 按扫描周期收集地址区间 [start, end)，只合并同一扫描类内的寄存器组
+    std::map<simtime_t, std::vector<std::pair<uint32_t, uint32_t>>> scanClasses;
+    for (int i = 0; i < numGroups; i++) {
+        if (groups[i].number == 0)
+            continue;
+        simtime_t interval = groups[i].scanInterval > 0 ? SimTime(groups[i].scanInterval) : defaultInterval;
+        scanClasses[interval].push_back({groups[i].startAddress, uint32_t(groups[i].startAddress) + groups[i].number});
+    }
 
-            // 读取保持寄存器组（功能码0x03）
-            for (int i = 0; i < slave.numRegisterGroup; i++) {
-                auto& group = slave.registerGroup[i];
-                auto pkt = createRequest(slave.slaveId, 0x03,
-                                         group.startAddress, group.number);
-                addPacketToQueue(pkt, conn.socketId);
-                // ownership moved to addPacketToQueue
+    for (auto& scanClass : scanClasses) {
+        auto& ranges = scanClass.second;
+        if (coalesceReads) {
+            // 按起始地址排序后合并：下一组与当前区间的空洞不超过coalesceGap，且合并后不超过单次读取上限
+            std::sort(ranges.begin(), ranges.end());
+            std::vector<std::pair<uint32_t, uint32_t>> merged;
+            for (const auto& range : ranges) {
+                if (!merged.empty()) {
+                    auto& last = merged.back();
+                    uint32_t end = std::max(last.second, range.second);
+                    if (range.first <= last.second + coalesceGap && end - last.first <= (uint32_t)maxQuantity) {
+                        last.second = end;
+                        continue;
+                    }
+                }
+                merged.push_back(range);
             }
+            ranges.swap(merged);
+        }
 
-            // 读取输入寄存器组（功能码0x04）
-            for (int i = 0; i < slave.numInputRegisterGroup; i++) {
-                auto& group = slave.inputRegisterGroup[i];
-                auto pkt = createRequest(slave.slaveId, 0x04,
-                                         group.startAddress, group.number);
-                addPacketToQueue(pkt, conn.socketId);
-                // ownership moved to addPacketToQueue
+        // 超过单次读取上限的区间拆分为多条请求
+        for (const auto& range : ranges) {
+            for (uint32_t addr = range.first; addr < range.second; addr += maxQuantity) {
+                PollRead read;
+                read.slaveId = slaveId;
+                read.functionCode = functionCode;
+                read.startAddress = addr;
+                read.quantity = std::min<uint32_t>(maxQuantity, range.second - addr);
+                read.scanInterval = scanClass.first;
+                read.pdu = encodeReadPdu(functionCode, read.startAddress, read.quantity);
+                plan.push_back(read);
             }
         }
     }
+}
 
-    EV_INFO << "===== 所有查询报文生成完成，共生成 " << totalRequestsGenerated << " 条请求 =====" << endl;
+Ptr<const BytesChunk> ModbusMasterApp::encodeReadPdu(uint8_t functionCode, uint16_t startAddress, uint16_t quantity) {
+    // 读请求PDU：[func(1)] + [start(2)] + [quantity(2)]
+    auto pduChunk = makeShared<BytesChunk>();
+    pduChunk->setBytes({functionCode,
+                        uint8_t((startAddress >> 8) & 0x00ff), uint8_t(startAddress & 0x00ff),
+                        uint8_t((quantity >> 8) & 0x00ff), uint8_t(quantity & 0x00ff)});
+    pduChunk->markImmutable();
+    return pduChunk;
+}
+
+int ModbusMasterApp::scatterBits(int connIdx, MSMapping& slave, AddressSpace space, uint16_t startAddress, uint16_t quantity, const uint8_t* data) {
+    int stored = 0;
+    uint32_t readEnd = uint32_t(startAddress) + quantity;
+    ModbusStorage::forEachGroupInRange<uint8_t>(slave, space, startAddress, quantity, [&](RegisterGroup<uint8_t>& group) {
+        uint32_t lo = std::max<uint32_t>(startAddress, group.startAddress);
+        uint32_t hi = std::min<uint32_t>(readEnd, uint32_t(group.startAddress) + group.number);
+        // Modbus位存储低位在前，组内地址连续，整段写入；数值有变化时更新组版本
+        bool changed = ModbusStorage::storeBits(group, lo - group.startAddress, data, lo - startAddress, hi - lo);
+        modbusStorage.touchGroup(connIdx, slave, group, changed, simTime());
+        stored += hi - lo;
+    });
+    return stored;
+}
 
+int ModbusMasterApp::scatterRegisters(int connIdx, MSMapping& slave, AddressSpace space, uint16_t startAddress, uint16_t quantity, const uint8_t* data) {
+    int stored = 0;
+    uint32_t readEnd = uint32_t(startAddress) + quantity;
+    ModbusStorage::forEachGroupInRange<int16_t>(slave, space, startAddress, quantity, [&](RegisterGroup<int16_t>& group) {
+        uint32_t lo = std::max<uint32_t>(startAddress, group.startAddress);
+        uint32_t hi = std::min<uint32_t>(readEnd, uint32_t(group.startAddress) + group.number);
+        // 组内地址连续，整段一次性大端转主机序；数值有变化时更新组版本
+        bool changed = ModbusStorage::storeRegisters(group, lo - group.startAddress, data + 2 * (lo - startAddress), hi - lo);
+        modbusStorage.touchGroup(connIdx, slave, group, changed, simTime());
+        stored += hi - lo;
+    });
+    return stored;
 }
 
 void ModbusMasterApp::socketEstablished(TcpSocket *socket) {
@@ -238,6 +737,17 @@ void ModbusMasterApp::socketEstablished(TcpSocket *socket) {
 
 }
 
+void ModbusMasterApp::socketClosed(TcpSocket *socket) {
+    dropConnection(socket->getSocketId());
+    ModbusTcpAppBase::socketClosed(socket);
+}
+
+void ModbusMasterApp::socketFailure(TcpSocket *socket, int code) {
+    // 父类会删除socket，先按socketId清理
+    dropConnection(socket->getSocketId());
+    ModbusTcpAppBase::socketFailure(socket, code);
+}
+
 void ModbusMasterApp::socketDataArrived(TcpSocket *socket, Packet *msg, bool urgent) {
     // 确保消息不为空
     if (!msg) {
@@ -286,78 +796,57 @@ void ModbusMasterApp::socketDataArrived(TcpSocket *socket, Packet *msg, bool urg
             EV_DEBUG << "Extracted Modbus response: transactionId=" << responseHeader->getTransactionId()
                       << ", length=" << responseLength << endl;
 
-            //判断是否为中转报文的响应
-            // 2. 获取TransitApp实例
-            EV_INFO << "开始查找TransitApp实例" << endl;
-            TransitApp *transitApp = check_and_cast<TransitApp*>(findModuleByPath("^.app[2]"));
-            if (!transitApp) {
-             EV_ERROR << "未找到TransitApp模块!" << endl;
-             continue;
+            // 3. 按(socketId, 事务ID)在关联表中查找对应的请求报文（响应可能乱序到达）
+            auto it = pendingTransactions.find(transactionKey(socketId, responseHeader->getTransactionId()));
+            if (it == pendingTransactions.end()) {
+                EV_WARN << "No pending request for transactionId=" << responseHeader->getTransactionId()
+                        << " on socket " << socketId << ", dropping response." << endl;
+                continue;
             }
-            EV_INFO << "成功获取TransitApp实例" << endl;
-
-            // 3. 获取TransitQueue实例
-            EV_INFO << "开始获取TransitApp实例" << endl;
-            auto transitQueue = transitApp->getTransitQueue();
-            if (!transitQueue) {  // 必须先检查是否为空
-                EV_ERROR << "获取的TransitQueue为空指针!" << endl;
-                return;
+            PendingTransaction transaction = it->second;
+            pendingTransactions.erase(it);
+            numInflight[socketId]--;
+            const auto& requestHeader = transaction.header;
+            const auto& requestPdu = transaction.pdu;
+            EV_DEBUG << "Matched transactionId=" << requestHeader->getTransactionId()
+                     << ", round-trip time=" << simTime() - transaction.sendTime
+                     << ", retries=" << transaction.retries << endl;
+            completePollRequest(transaction.taskIndex);
+            // 按Karn算法只用未重发的请求更新RTT
+            if (transaction.retries == 0)
+                updateRtt(socketId, simTime() - transaction.sendTime);
+            // 按优先级统计从入队到收到响应的时延（含排队时间）
+            emit(transaction.transit ? operatorLatencySignal : pollLatencySignal, simTime() - transaction.enqueueTime);
+
+            // 4. 中转请求的响应：通过TransitApp回送给指令来源
+            if (transaction.transit) {
+                TransitApp *transitApp = check_and_cast<TransitApp*>(findModuleByPath("^.app[2]"));
+                auto transitResponse = new Packet("transitResponse", TCP_C_SEND);
+                transitResponse->insertAtFront(responseHeader);
+                transitResponse->insertAtBack(responsePdu);
+                // Add creation time so the receiver can compute dataAge
+                transitResponse->addTag<CreationTimeTag>()->setCreationTime(simTime());
+                transitApp->sendBack(transitResponse);
             }
-            EV_INFO << "成功获取TransitQueue实例" << endl;
-
-            if(transitQueue->has<ModbusHeader>()){
-                auto transitRequestHeader = transitQueue->peek<ModbusHeader>();
-                if(responseHeader->getTransactionId() == transitRequestHeader->getTransactionId()){
-
-                    auto transitResponse = new Packet("transitResponse", TCP_C_SEND);
 
-                    transitResponse->insertAtFront(responseHeader);
-                    transitResponse->insertAtBack(responsePdu);
-                    // Add creation time so the receiver can compute dataAge
-                    transitResponse->addTag<CreationTimeTag>()->setCreationTime(simTime());
-
-                    transitApp->sendBack(transitResponse);
-                    transitQueue->pop<ModbusHeader>();
-                    B pduLength = B(transitRequestHeader->getLength() - 1);
-                    transitQueue->pop<BytesChunk>(pduLength);
-                }
-            }
-
-            // 3. 获取对应的待处理请求报文
-            if (!waitProcessPacketSocketQueue[socketId].has<ModbusHeader>()) {
-                EV_DEBUG << "No complete ModbusHeader in waitProcessPacketSocketQueue, waiting for more data." << endl;
-                break;
-            }
-            const auto& requestHeader = waitProcessPacketSocketQueue[socketId].pop<ModbusHeader>();
-            const auto& requestPdu = waitProcessPacketSocketQueue[socketId].pop<BytesChunk>(B(requestHeader->getLength() - 1));
-
-            // 5. 验证响应报文的正确性（简单示例：对比transactionId和slaveId）
-            bool isResponseValid = (responseHeader->getTransactionId() == requestHeader->getTransactionId()) &&
-                                   (responseHeader->getSlaveId() == requestHeader->getSlaveId());
+            // 5. 验证响应报文的正确性（事务ID已匹配，再对比slaveId）
+            bool isResponseValid = (responseHeader->getSlaveId() == requestHeader->getSlaveId());
 
             if (!isResponseValid) {
-                EV_ERROR << "Invalid response: transactionId or slaveId mismatch with request." << endl;
-
+                EV_ERROR << "Invalid response: slaveId mismatch with request." << endl;
+                scheduleSendIfPending();
                 continue;
             }
 
             // 6. 处理正确的响应
+            recordSlaveSuccess(socketId, requestHeader->getSlaveId());
+            uint64_t generation = modbusStorage.getGeneration();
             parseAndStoreResponse(socket, requestPdu, responseHeader, responsePdu);
+            if (modbusStorage.getGeneration() != generation)
+                emit(storageChangedSignal, (intval_t)modbusStorage.getGeneration());
 
-            // 查找队列是否为空
-            bool isEmpty = true;
-            for (const auto& queue : sendSocketQueue) {
-                if (queue.second.getLength() > b(0)) {
-                    isEmpty = false;
-                    break;
-                }
-            }
-
-            if (isEmpty) {
-                EV_INFO << "所有发送队列均为空，无需发送数据" << endl;
-            }else{
-                scheduleAt(simTime(), sendNextTimer); // 立即触发第一个发送
-            }
+            // 在途窗口已释放，继续发送队列中的请求
+            scheduleSendIfPending();
 
         }
     }
@@ -369,7 +858,7 @@ void ModbusMasterApp::socketDataArrived(TcpSocket *socket, Packet *msg, bool urg
 //    ModbusTcpAppBase::socketDataArrived(socket, msg, urgent);
     delete msg;
 }
-void ModbusMasterApp::addPacketToQueue(Packet* pkt, int socketId){
+void ModbusMasterApp::addPacketToQueue(Packet* pkt, int socketId, bool transit){
 
     // 关键：切换到ModbusMasterApp的上下文，记录调试信息
     Enter_Method("addPacketToQueue");
@@ -387,14 +876,20 @@ void ModbusMasterApp::addPacketToQueue(Packet* pkt, int socketId){
 //-        return;
 //-    }
 //-    throw cRuntimeError("未找到socketId对应的socket,packet未加入队列");
-    // Don't change packet owner here; just extract the data chunk and then free the packet
+    // Don't change packet owner here; just extract the header and PDU and then free the packet
     auto socket = socketMap.getSocketById(socketId);
 
     if (socket) {
         int sid = socket->getSocketId();
-        // extract data chunk (this returns a shared chunk that remains valid after deleting the packet)
-        auto chunk = pkt->peekDataAt(B(0), pkt->getTotalLength());
-        sendSocketQueue[sid].push(chunk);
+        // 头部只保留事务ID和从站ID，发送时重新生成
+        const auto& header = pkt->popAtFront<ModbusHeader>();
+        QueuedRequest request;
+        request.transactionId = header->getTransactionId();
+        request.slaveId = header->getSlaveId();
+        request.pdu = pkt->peekDataAsBytes();  // shared chunk remains valid after deleting the packet
+        request.enqueueTime = simTime();
+        request.transit = transit;  // 中转请求的响应到达时经TransitApp回送
+        enqueueRequest(sid, request);
         EV_INFO << "packet成功加入队列 (socketId=" << sid << ")" << endl;
         // delete the temporary Packet to avoid leaving it undisposed
         delete pkt;
@@ -527,32 +1022,14 @@ Packet* ModbusMasterApp::createRequest(uint8_t slaveId, uint8_t functionCode,
             pdu.push_back(quantityHigh);
             pdu.push_back(quantityLow);
 
-            // 构建比特序列并补0
-            std::vector<bool> bits;
-            bits.reserve(quantity);
-            for (uint8_t byte : data) {
-                bits.push_back(byte != 0);
-            }
-            int currentBits = bits.size();
-            int padding = (8 - (currentBits % 8)) % 8;
-            for (int i = 0; i < padding; ++i) bits.push_back(false);
-
-            // 每8位打包成一个字节
-            std::vector<uint8_t> packedBytes;
-            for (size_t i = 0; i < bits.size(); i += 8) {
-                uint8_t byte = 0;
-                for (int j = 0; j < 8; ++j) {
-                    if (bits[i + j]) byte |= (1 << j);
-                }
-                packedBytes.push_back(byte);
-            }
+            // 按低位在前打包，末字节高位补0
+            size_t byteCount = (quantity + 7) / 8;
+            pdu.push_back(byteCount);
+            size_t dataOffset = pdu.size();
+            pdu.resize(dataOffset + byteCount);
+            packBits(pdu.data() + dataOffset, data.data(), quantity);
 
-            // 添加字节数
-            pdu.push_back(packedBytes.size());
-            // 添加打包后的数据
-            for (uint8_t b : packedBytes) pdu.push_back(b);
-
-            dataLength = packedBytes.size() + 3; // 2字节数量 + 1字节字节数 + 数据
+            dataLength = byteCount + 3; // 2字节数量 + 1字节字节数 + 数据
 
             tempChunk->setBytes(pdu);
             pduChunk = tempChunk;
@@ -780,14 +1257,7 @@ void ModbusMasterApp::parseAndStoreResponse(TcpSocket *socket, const inet::Ptr<c
         EV_WARN << "parseAndStoreResponse: 未找到socketId=" << socketId << "的连接" << endl;
         return;
     }
-    inet::connect& targetConn = modbusStorage.getConnect(connIdx);
-    inet::MSMapping* targetSlave = nullptr;
-    for (int i = 0; i < targetConn.numSlave; i++) {
-        if (targetConn.slaves[i].slaveId == slaveId) {
-            targetSlave = &targetConn.slaves[i];
-            break;
-        }
-    }
+    inet::MSMapping* targetSlave = modbusStorage.findSlave(connIdx, slaveId);
     if (!targetSlave) {
         EV_WARN << "parseAndStoreResponse: 未找到从站ID=" << (int)slaveId << "的配置" << endl;
         return;
@@ -809,67 +1279,32 @@ void ModbusMasterApp::parseAndStoreResponse(TcpSocket *socket, const inet::Ptr<c
         const uint8_t* dataStart = &responseBytes[2];
 
         // 7.1 线圈/离散输入（位数据）处理
+        // 合并读取的响应按地址分发回各原始寄存器组，组间空洞地址直接丢弃
+        int stored = 0;
         if (respFuncCode == 0x01 || respFuncCode == 0x02) {
-            std::vector<inet::RegisterGroup<uint8_t>*> bitGroups;
-            if (respFuncCode == 0x01) {
-                for (int i = 0; i < targetSlave->numBitGroup; i++) {
-                    bitGroups.push_back(&targetSlave->bitGroup[i]); // 取对象地址
-                }
-            } else {
-                for (int i = 0; i < targetSlave->numInputBitGroup; i++) {
-                    bitGroups.push_back(&targetSlave->inputBitGroup[i]);
-                }
-            }
-
-            for (uint16_t i = 0; i < quantity; i++) {
-                uint16_t currAddr = startAddress + i;
-                inet::RegisterGroup<uint8_t>* targetGroup = nullptr;
-                for (auto group : bitGroups) {
-                    if (currAddr >= group->startAddress && currAddr < group->startAddress + group->number) {
-                        targetGroup = group;
-                        break;
-                    }
-                }
-                if (!targetGroup) {
-                    EV_WARN << "parseAndStoreResponse: 地址" << currAddr << "不在任何位寄存器组中" << endl;
-                    continue;
-                }
-                uint16_t offset = currAddr - targetGroup->startAddress;
-                uint16_t byteIdx = i / 8;
-                uint8_t bitIdx = i % 8; // Modbus位存储高位在后
-                targetGroup->data[offset] = (dataStart[byteIdx] >> bitIdx) & 0x01;
+            if (dataLength < (quantity + 7) / 8) {
+                EV_ERROR << "parseAndStoreResponse: 位数据长度不足（数量" << quantity << "，实际" << (int)dataLength << "字节）" << endl;
+                return;
             }
+            if (respFuncCode == 0x01)
+                stored = scatterBits(connIdx, *targetSlave, COILS, startAddress, quantity, dataStart);
+            else
+                stored = scatterBits(connIdx, *targetSlave, DISCRETE_INPUTS, startAddress, quantity, dataStart);
         }
         // 7.2 保持寄存器/输入寄存器（16位数据）处理
         else {
-            std::vector<inet::RegisterGroup<int16_t>*> regGroups;
-            if (respFuncCode == 0x03) {
-                for (int i = 0; i < targetSlave->numRegisterGroup; i++) {
-                    regGroups.push_back(&targetSlave->registerGroup[i]);
-                }
-            } else {
-                for (int i = 0; i < targetSlave->numInputRegisterGroup; i++) {
-                    regGroups.push_back(&targetSlave->inputRegisterGroup[i]);
-                }
-            }
-
-            for (uint16_t i = 0; i < quantity; i++) {
-                uint16_t currAddr = startAddress + i;
-                inet::RegisterGroup<int16_t>* targetGroup = nullptr;
-                for (auto group : regGroups) {
-                    if (currAddr >= group->startAddress && currAddr < group->startAddress + group->number) {
-                        targetGroup = group;
-                        break;
-                    }
-                }
-                if (!targetGroup) {
-                    EV_WARN << "parseAndStoreResponse: 地址" << currAddr << "不在任何16位寄存器组中" << endl;
-                    continue;
-                }
-                uint16_t offset = currAddr - targetGroup->startAddress;
-                int16_t data = int16_t(dataStart[2*i]) << 8 | uint16_t(dataStart[2*i + 1]); // 大端转主机序
-                targetGroup->data[offset] = data;
+            if (dataLength < quantity * 2) {
+                EV_ERROR << "parseAndStoreResponse: 寄存器数据长度不足（数量" << quantity << "，实际" << (int)dataLength << "字节）" << endl;
+                return;
             }
+            if (respFuncCode == 0x03)
+                stored = scatterRegisters(connIdx, *targetSlave, HOLDING_REGISTERS, startAddress, quantity, dataStart);
+            else
+                stored = scatterRegisters(connIdx, *targetSlave, INPUT_REGISTERS, startAddress, quantity, dataStart);
+        }
+        if (stored == 0) {
+            EV_WARN << "parseAndStoreResponse: 地址范围[" << startAddress << ", " << startAddress + quantity
+                    << ")不在任何寄存器组中" << endl;
         }
     }
     // 8. 处理单个写操作响应（0x05/0x06）
@@ -888,23 +1323,11 @@ void ModbusMasterApp::parseAndStoreResponse(TcpSocket *socket, const inet::Ptr<c
         // 8.1 单个线圈写入（0x05）
         if (respFuncCode == 0x05) {
             uint8_t bitValue = (data == 0xFF00) ? 1 : 0; // 0xFF00=ON, 0x0000=OFF
-            for (int i = 0; i < targetSlave->numBitGroup; i++) {
-                auto& group = targetSlave->bitGroup[i];
-                if (startAddress >= group.startAddress && startAddress < group.startAddress + group.number) {
-                    group.data[startAddress - group.startAddress] = bitValue;
-                    break;
-                }
-            }
+            scatterBits(connIdx, *targetSlave, COILS, startAddress, 1, &bitValue);
         }
         // 8.2 单个寄存器写入（0x06）
         else {
-            for (int i = 0; i < targetSlave->numRegisterGroup; i++) {
-                auto& group = targetSlave->registerGroup[i];
-                if (startAddress >= group.startAddress && startAddress < group.startAddress + group.number) {
-                    group.data[startAddress - group.startAddress] = data;
-                    break;
-                }
-            }
+            scatterRegisters(connIdx, *targetSlave, HOLDING_REGISTERS, startAddress, 1, &responseBytes[3]);
         }
     }
     // 9. 处理多个写操作响应（0x0F/0x10）
@@ -928,19 +1351,12 @@ void ModbusMasterApp::parseAndStoreResponse(TcpSocket *socket, const inet::Ptr<c
 
         // 9.1 多个线圈写入（0x0F）
         if (respFuncCode == 0x0F) {
-            for (uint16_t i = 0; i < quantity; i++) {
-                uint16_t currAddr = startAddress + i;
-                for (int g = 0; g < targetSlave->numBitGroup; g++) {
-                    auto& group = targetSlave->bitGroup[g];
-                    if (currAddr >= group.startAddress && currAddr < group.startAddress + group.number) {
-                        uint16_t offset = currAddr - group.startAddress;
-                        uint16_t byteIdx = i / 8;
-                        uint8_t bitIdx = 7 - (i % 8);
-                        group.data[offset] = (dataStart[byteIdx] >> bitIdx) & 0x01;
-                        break;
-                    }
-                }
+            // 与请求编码一致，按低位在前展开
+            if (dataLength < (quantity + 7) / 8) {
+                EV_WARN << "parseAndStoreResponse: 多个线圈数据长度不足" << endl;
+                return;
             }
+            scatterBits(connIdx, *targetSlave, COILS, startAddress, quantity, dataStart);
         }
         // 9.2 多个寄存器写入（0x10）
         else {
@@ -948,18 +1364,7 @@ void ModbusMasterApp::parseAndStoreResponse(TcpSocket *socket, const inet::Ptr<c
                 EV_WARN << "parseAndStoreResponse: 多个寄存器数据长度不匹配" << endl;
                 return;
             }
-            for (uint16_t i = 0; i < quantity; i++) {
-                uint16_t currAddr = startAddress + i;
-                for (int g = 0; g < targetSlave->numRegisterGroup; g++) {
-                    auto& group = targetSlave->registerGroup[g];
-                    if (currAddr >= group.startAddress && currAddr < group.startAddress + group.number) {
-                        uint16_t offset = currAddr - group.startAddress;
-                        uint16_t data = (dataStart[2*i] << 8) | dataStart[2*i + 1];
-                        group.data[offset] = data;
-                        break;
-                    }
-                }
-            }
+            scatterRegisters(connIdx, *targetSlave, HOLDING_REGISTERS, startAddress, quantity, dataStart);
         }
     }
     // 10. 处理读写多个寄存器响应（0x17）
@@ -984,26 +1389,9 @@ void ModbusMasterApp::parseAndStoreResponse(TcpSocket *socket, const inet::Ptr<c
             quantity = dataLength / 2;
         }
 
-        std::vector<inet::RegisterGroup<int16_t>*> regGroups;
-        for (int i = 0; i < targetSlave->numRegisterGroup; i++) {
-            regGroups.push_back(&targetSlave->registerGroup[i]);
-        }
-        for (uint16_t i = 0; i < quantity; i++) {
-            uint16_t currAddr = startAddress + i;
-            inet::RegisterGroup<int16_t>* targetGroup = nullptr;
-            for (auto group : regGroups) {
-                if (currAddr >= group->startAddress && currAddr < group->startAddress + group->number) {
-                    targetGroup = group;
-                    break;
-                }
-            }
-            if (!targetGroup) {
-                EV_WARN << "parseAndStoreResponse: 地址" << currAddr << "不在任何16位寄存器组中" << endl;
-                continue;
-            }
-            uint16_t offset = currAddr - targetGroup->startAddress;
-            int16_t value = int16_t(dataStart[2*i]) << 8 | uint16_t(dataStart[2*i + 1]);
-            targetGroup->data[offset] = value;
+        if (scatterRegisters(connIdx, *targetSlave, HOLDING_REGISTERS, startAddress, quantity, dataStart) == 0) {
+            EV_WARN << "parseAndStoreResponse: 地址范围[" << startAddress << ", " << startAddress + quantity
+                    << ")不在任何16位寄存器组中" << endl;
         }
     }
 
@@ -1011,11 +1399,21 @@ void ModbusMasterApp::parseAndStoreResponse(TcpSocket *socket, const inet::Ptr<c
             << ", 从站ID: " << (int)slaveId << std::dec << endl;
 }
 
+void ModbusMasterApp::finish() {
+    ModbusTcpAppBase::finish();
+    recordScalar("pollCycles", numPollCycles);
+    recordScalar("pollOverruns", numPollOverruns);
+    recordScalar("dedupedPollRequests", numDedupedRequests);
+    EV_INFO << getFullPath() << ": " << numPollCycles << " poll cycles completed, " << numPollOverruns
+            << " overruns, " << numDedupedRequests << " deduplicated requests\n";
+}
+
 // 实现纯虚函数：启动操作
 void ModbusMasterApp::handleStartOperation(LifecycleOperation *operation) {
     // 启动时开始定时读取
     if (readTimer && !readTimer->isScheduled()) {
-        scheduleAt(simTime(), readTimer);
+        restartScanSchedule(simTime());
+        scheduleNextScan();
     }
 }
 
@@ -1029,6 +1427,16 @@ void ModbusMasterApp::handleStopOperation(LifecycleOperation *operation) {
     if (sendNextTimer && sendNextTimer->isScheduled()) {
         cancelEvent(sendNextTimer);
     }
+    if (timeoutTimer && timeoutTimer->isScheduled()) {
+        cancelEvent(timeoutTimer);
+    }
+    pendingTransactions.clear();
+    numInflight.clear();
+    sendQueues.clear();
+    resetPollProgress();
+    timeoutWheel.reset(simTime());
+    slaveHealth.clear();
+    numQuarantinedSlaves = 0;
     // 关闭所有连接
     closeAll();
 }
@@ -1045,6 +1453,11 @@ void ModbusMasterApp::handleCrashOperation(LifecycleOperation *operation) {
         cancelAndDelete(sendNextTimer);
         sendNextTimer = nullptr;
     }
+
+    if (timeoutTimer) {
+        cancelAndDelete(timeoutTimer);
+        timeoutTimer = nullptr;
+    }
     // 关闭所有连接
     closeAll();
 }
@@ -1,9 +1,14 @@
 #ifndef MODBUSMASTERAPP_H_
 #define MODBUSMASTERAPP_H_
 
+#include <deque>
+#include <functional>
+#include <queue>
+#include <unordered_map>
 #include "ModbusHeader_m.h"
 #include "ModbusStorage.h"
 #include "ModbusTcpAppBase.h"
+#include "ModbusTimerWheel.h"
 #include "inet/applications/tcpapp/TcpBasicClientApp.h"
 
 namespace inet {
@@ -14,35 +19,199 @@ protected:
     cMessage *readTimer = nullptr;  // 定时读取定时器
 
     cMessage *sendNextTimer = nullptr;
+    cMessage *timeoutTimer = nullptr;  // 驱动超时时间轮的唯一定时器
     simtime_t readInterval;         // 读取间隔时间
     int transactionId = 1;          // 事务ID计数器
-    int connectIndex = 0;
-    uint16_t pretransactionId = 0;
+    int maxOutstandingPerConnection = 1;  // 每个连接允许同时在途（已发送未响应）的最大事务数
+    simtime_t responseTimeout;            // 响应超时时间（0表示不检测超时）
+    int maxRetries = 0;                   // 超时后的最大重发次数
+    simtime_t quarantineBackoff;          // 从站无响应后的初始隔离时长（0表示不隔离）
+    simtime_t maxQuarantineBackoff;       // 隔离时长上限（指数退避）
 
+    // 事务关联表条目：已发送、等待响应的请求
+    struct PendingTransaction {
+        int socketId = -1;
+        Ptr<const ModbusHeader> header;  // 请求头部
+        Ptr<const BytesChunk> pdu;       // 请求PDU
+        simtime_t enqueueTime;           // 入队时间（用于统计各优先级的端到端时延）
+        simtime_t sendTime;              // 最近一次发送时间
+        simtime_t deadline;              // 当前超时截止时间（用于时间轮惰性取消）
+        int retries = 0;                 // 已重发次数
+        bool transit = false;            // 是否为TransitApp注入的中转请求
+        int taskIndex = -1;              // 所属扫描任务（周期轮询请求），-1表示不属于轮询计划
+    };
+
+    // 发送队列条目：PDU为只读共享块（轮询请求直接引用轮询计划中的预编码PDU），
+    // MBAP头部在发送时才按事务ID生成
+    struct QueuedRequest {
+        uint16_t transactionId = 0;
+        uint8_t slaveId = 0;
+        Ptr<const BytesChunk> pdu;
+        simtime_t enqueueTime;           // 入队时间（作为请求的创建时间）
+        bool transit = false;            // 是否为TransitApp注入的中转请求
+        int taskIndex = -1;              // 所属扫描任务，-1表示不属于轮询计划
+        int planIndex = -1;              // 在pollPlan[连接索引]中的条目下标
+    };
+
+    // 每个连接的发送车道：运维/中转请求优先于周期轮询
+    enum RequestLane { LANE_OPERATOR = 0, LANE_CYCLIC = 1, NUM_LANES };
+    struct SendLanes {
+        std::deque<QueuedRequest> lane[NUM_LANES];
+        int operatorCredit = 0;  // 加权模式下运维车道在让出一次之前还可连续发送的请求数（创建时置为operatorLaneWeight）
+        bool empty() const { return lane[LANE_OPERATOR].empty() && lane[LANE_CYCLIC].empty(); }
+    };
 
     std::map<int, ChunkQueue> socketQueue;
-    std::map<int, ChunkQueue> sendSocketQueue;
+    std::map<int, SendLanes> sendQueues;  // 按socketId管理的发送队列
+    bool weightedLanes = false;     // false：严格优先；true：加权轮转
+    int operatorLaneWeight = 4;     // 加权模式下两条车道都有积压时，每发送1条轮询请求前可发送的运维请求数
+    // 事务关联表：以(socketId, 事务ID)为键，响应可按任意顺序O(1)匹配
+    std::unordered_map<uint64_t, PendingTransaction> pendingTransactions;
+    std::map<int, int> numInflight;                    // 每个连接的在途事务数
+
+    static uint64_t transactionKey(int socketId, uint16_t transactionId) {
+        return (uint64_t(uint32_t(socketId)) << 16) | transactionId;
+    }
+
+    // 轮询计划条目：一次合法的读请求（可能覆盖多个寄存器组）
+    struct PollRead {
+        uint8_t slaveId = 0;
+        uint8_t functionCode = 0;
+        uint16_t startAddress = 0;
+        uint16_t quantity = 0;
+        simtime_t scanInterval;     // 所属扫描类的轮询周期
+        Ptr<const BytesChunk> pdu;  // 预编码的请求PDU，计划生成后不再修改，各周期共享
+    };
+    // 按连接索引存放的轮询计划，仅在rebuildPollPlan()中生成，每周期只分配事务ID
+    std::vector<std::vector<PollRead>> pollPlan;
+
+    // 扫描任务：同一连接下轮询周期相同的计划条目（一个扫描类）
+    struct ScanTask {
+        int connIdx = -1;
+        simtime_t interval;
+        std::vector<int> reads;  // pollPlan[connIdx]中的条目下标
+        simtime_t nextDue;       // 下次到期时间
+        simtime_t cycleStart;    // 当前（未完成）周期的开始时间
+        int outstanding = 0;     // 尚未完成（排队或在途）的请求数，为0表示当前周期已完成
+    };
+    std::vector<ScanTask> scanTasks;
+    // 每个计划条目是否已有未发送的请求在排队（按[连接索引][条目下标]），用于去重：同一组只保留一条排队请求
+    std::vector<std::vector<bool>> readQueued;
+    long numPollOverruns = 0;      // 周期超期次数
+    long numPollCycles = 0;        // 已完成的轮询周期数
+    long numDedupedRequests = 0;   // 因同一组已在排队而未重复入队的请求数
+    // 按到期时间排序的最小堆（到期时间, scanTasks下标），readTimer总是调度到堆顶
+    typedef std::pair<simtime_t, int> ScanDue;
+    std::priority_queue<ScanDue, std::vector<ScanDue>, std::greater<ScanDue>> scanQueue;
+    // 错峰启动：各连接的扫描起点相对周期的偏移比例（0~1），避免所有请求在同一时刻就绪
+    enum StaggerMode { STAGGER_NONE, STAGGER_EVEN, STAGGER_RANDOM };
+    StaggerMode pollStagger = STAGGER_NONE;
+    int staggerSeed = 0;
+    std::vector<double> connectPhase;  // 按连接索引
+
+    // 自适应轮询：按连接跟踪平滑RTT与积压，在[minPollScale, maxPollScale]内伸缩扫描周期
+    struct ConnectionRate {
+        double requestRate = 0;  // 按基准周期计算的计划请求速率（条/秒）
+        simtime_t srtt;          // 平滑往返时间
+        bool hasRtt = false;
+        double scale = 1;        // 当前周期伸缩系数（实际周期 = 基准周期 * scale）
+        int pacingTask = -1;     // 该连接基准周期最短的扫描任务，伸缩系数只在它到期时调整（每连接每周期一次）
+        bool overrunSeen = false;  // 自上次调整以来该连接是否有扫描任务超期
+    };
+    std::vector<ConnectionRate> connectRate;  // 按连接索引
+    bool adaptivePolling = false;
+    double minPollScale = 1;
+    double maxPollScale = 1;
+    double targetUtilization = 1;  // 期望的连接占用率（轮询所需时间 / 周期）
+    bool coalesceReads = false;  // 是否合并相邻/近邻寄存器组
+    int coalesceGap = 0;         // 合并时允许跨越的最大地址空洞
+
+    TimerWheel<uint64_t> timeoutWheel;  // 所有在途请求的超时共用一个时间轮
+
+    // 从站健康状态：连续失败次数与隔离截止时间
+    struct SlaveHealth {
+        int consecutiveFailures = 0;
+        bool quarantined = false;
+        simtime_t quarantinedUntil;
+    };
+    std::map<std::pair<int, uint8_t>, SlaveHealth> slaveHealth;  // 以(socketId, slaveId)为键
+    int numQuarantinedSlaves = 0;
+
+    // statistics
+    static simsignal_t requestTimeoutSignal;
+    static simsignal_t requestRetrySignal;
+    static simsignal_t quarantinedSlavesSignal;
+    static simsignal_t operatorLatencySignal;
+    static simsignal_t pollLatencySignal;
+    static simsignal_t pollOverrunSignal;
+    static simsignal_t pollScaleSignal;
+    static simsignal_t pollCycleTimeSignal;
+    static simsignal_t storageChangedSignal;
 
 protected:
     virtual int numInitStages() const override { return NUM_INIT_STAGES; }
     virtual void initialize(int stage) override;
     virtual void handleTimer(cMessage *msg) override;
+    virtual void finish() override;
     virtual void socketDataArrived(TcpSocket *socket, Packet *msg, bool urgent) override;
     // 重写连接建立回调
     virtual void socketEstablished(TcpSocket *socket) override;
+    // 连接关闭或失败时立即结束该连接排队和在途的请求
+    virtual void socketClosed(TcpSocket *socket) override;
+    virtual void socketFailure(TcpSocket *socket, int code) override;
 
 
 
     virtual void handleStartOperation(LifecycleOperation *operation) override;
     virtual void handleStopOperation(LifecycleOperation *operation) override;
     virtual void handleCrashOperation(LifecycleOperation *operation) override;
-    void generateQueryPacket(std::map<int, ChunkQueue>& sendSocketQueue);
+    void generateQueryPacket();
+    // 在各连接的在途窗口允许范围内，发送发送队列中的请求（各连接相互独立）
+    virtual void sendQueuedRequests();
+    void enqueueRequest(int socketId, const QueuedRequest& request);
+    // 按严格优先或加权轮转从车道中取出下一条请求，全部为空时返回false
+    bool dequeueRequest(SendLanes& lanes, QueuedRequest& request);
+    // 丢弃连接的发送队列：清除轮询条目的排队标记并计为完成，中转请求回送异常
+    void dropQueuedRequests(int socketId);
+    // 连接终止：丢弃发送队列，在途事务立即按失败结束（不计入从站隔离），清理接收队列
+    void dropConnection(int socketId);
+    // 若仍有待发送的请求，立即调度一次发送定时器
+    void scheduleSendIfPending();
+
+    // 轮询计划：将寄存器组合并为尽量少的读请求
+    static Ptr<const BytesChunk> encodeReadPdu(uint8_t functionCode, uint16_t startAddress, uint16_t quantity);
+    template <typename ElementType>
+    void planGroupReads(std::vector<PollRead>& plan, uint8_t slaveId, uint8_t functionCode,
+                        const RegisterGroup<ElementType>* groups, int numGroups, int maxQuantity, simtime_t defaultInterval) const;
+    // 多速率扫描调度：所有扫描任务从start开始重新计时；readTimer调度到最早到期的任务
+    void restartScanSchedule(simtime_t start);
+    void computeConnectPhases();
+    // 扫描任务到期时检查上一周期是否超期，并更新所属连接的周期伸缩系数
+    void adaptPollRate(int taskIdx, bool overrun);
+    // 轮询请求完成（收到响应、最终失败或被丢弃）时调用，周期内请求全部完成时记录周期耗时
+    void completePollRequest(int taskIndex);
+    void resetPollProgress();
+    void updateRtt(int socketId, simtime_t rtt);
+    void scheduleNextScan();
+    // 将读响应数据分发回与[startAddress, startAddress+quantity)相交的各寄存器组并更新组版本，返回写入的点数
+    int scatterBits(int connIdx, MSMapping& slave, AddressSpace space, uint16_t startAddress, uint16_t quantity, const uint8_t* data);
+    int scatterRegisters(int connIdx, MSMapping& slave, AddressSpace space, uint16_t startAddress, uint16_t quantity, const uint8_t* data);
+
+    // 超时、重发与从站隔离
+    void armTimeout(uint64_t key, PendingTransaction& transaction);
+    virtual void handleTimeouts();
+    virtual void handleTransactionFailure(const PendingTransaction& transaction);
+    // 中转请求无法完成时经TransitApp回送网关目标无响应异常（0x0B）
+    virtual void sendTransitException(uint16_t transactionId, uint8_t slaveId, const Ptr<const BytesChunk>& pdu);
+    void recordSlaveFailure(int socketId, uint8_t slaveId);
+    void recordSlaveSuccess(int socketId, uint8_t slaveId);
+    bool isSlaveQuarantined(int socketId, uint8_t slaveId);
 
 
 public:
     ModbusMasterApp() {}
     virtual ~ModbusMasterApp() { 
-        // Ensure both timers are cancelled and deleted to avoid undisposed object warnings
+        // Ensure all timers are cancelled and deleted to avoid undisposed object warnings
         if (readTimer) {
             cancelAndDelete(readTimer);
             readTimer = nullptr;
@@ -51,6 +220,10 @@ public:
             cancelAndDelete(sendNextTimer);
             sendNextTimer = nullptr;
         }
+        if (timeoutTimer) {
+            cancelAndDelete(timeoutTimer);
+            timeoutTimer = nullptr;
+        }
     }
 
     // 生成读请求报文
@@ -68,7 +241,11 @@ public:
         uint16_t writeQuantity,
         const std::vector<uint8_t>& writeData);
 
-    virtual void addPacketToQueue(Packet* pkt, int socketId);
+    // 根据当前寄存器组配置重建轮询计划（配置加载后自动调用，修改组配置后需再次调用）
+    virtual void rebuildPollPlan();
+
+    // transit为true表示请求来自TransitApp，其响应需经TransitApp回送
+    virtual void addPacketToQueue(Packet* pkt, int socketId, bool transit = false);
     // 解析收到的响应报文并存储
     virtual void parseAndStoreResponse(TcpSocket *socket, const inet::Ptr<const BytesChunk>& requestPdu, const inet::Ptr<const ModbusHeader>& responseHeader, const inet::Ptr<const BytesChunk>& responsePdu);
 
@@ -6,6 +6,7 @@
  */
 
 #include "ModbusSlaveApp.h"
+#include "ModbusCodec.h"
 #include "inet/common/ModuleAccess.h"
 #include "inet/common/ProtocolTag_m.h"
 #include "inet/common/packet/Message.h"
@@ -13,7 +14,13 @@
 #include "inet/common/socket/SocketTag_m.h"
 #include "inet/networklayer/common/L3AddressResolver.h"
 #include "inet/transportlayer/contract/tcp/TcpCommand_m.h"
+#include <algorithm>
+#include <bitset>
+#include <cmath>
 #include <fstream>
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
 #include "inet/common/lifecycle/NodeStatus.h"
 #include "inet/networklayer/common/InterfaceTable.h"
 #include "inet/common/TimeTag_m.h"
@@ -22,6 +29,18 @@ namespace inet {
 
 Define_Module(ModbusSlaveApp);
 
+simsignal_t ModbusSlaveApp::queueingDelaySignal = registerSignal("queueingDelay");
+simsignal_t ModbusSlaveApp::requestQueueLengthSignal = registerSignal("requestQueueLength");
+simsignal_t ModbusSlaveApp::allocationsPerRequestSignal = registerSignal("allocationsPerRequest");
+
+ModbusSlaveApp::~ModbusSlaveApp()
+{
+    for (auto& entry : slaveBehaviors)
+        cancelAndDelete(entry.updateTimer);
+    for (auto& entry : inService)
+        cancelAndDelete(entry.first);
+}
+
 void ModbusSlaveApp::initialize(int stage)
 {
     cSimpleModule::initialize(stage);
@@ -29,10 +48,41 @@ void ModbusSlaveApp::initialize(int stage)
     if (stage == INITSTAGE_LOCAL) {
         // 从ini文件获取配置路径
         slavesConfigPath = par("slavesConfigPath").stringValue();
+        modbusStorage.setBitPackedCoils(par("packedCoils"));
+        coalesceResponses = par("coalesceResponses");
+        behaviorInterval = par("behaviorInterval");
+        if (behaviorInterval <= SIMTIME_ZERO)
+            throw cRuntimeError("behaviorInterval must be positive");
+        parseServiceTimeTable(par("serviceTimeTable"));
+        concurrency = par("concurrency");
+        if (concurrency < 1)
+            throw cRuntimeError("concurrency must be at least 1");
+        queueCapacity = par("queueCapacity");
+        gatewayMode = par("gatewayMode");
+        serialBaudRate = par("serialBaudRate");
+        serialCharBits = par("serialCharBits");
+        if (serialBaudRate < 0 || serialCharBits < 1)
+            throw cRuntimeError("serialBaudRate must not be negative and serialCharBits must be positive");
+        if (serialBaudRate > 0)
+            concurrency = 1;  // 串行总线同一时刻只能进行一个事务，所有单元的请求在总线上串行
+        // serviceTime为常量0且没有按功能码配置时保持原来的零时延处理
+        cPar& serviceTimePar = par("serviceTime");
+        serviceModelEnabled = !serviceTimeTable.empty() || serviceTimePar.isExpression() || serviceTimePar.doubleValue() != 0 || serialBaudRate > 0;
+        if (par("countAllocations")) {
+            // 计数函数由预加载的bench/libAllocationCounter.so提供
+#ifndef _WIN32
+            allocationCounter = reinterpret_cast<unsigned long (*)()>(dlsym(RTLD_DEFAULT, "modbusAllocationCount"));
+#endif
+            if (!allocationCounter)
+                throw cRuntimeError("countAllocations requires bench/libAllocationCounter.so to be preloaded (LD_PRELOAD)");
+        }
+        txBuffer.reserve(1500);
         WATCH(requestsRcvd);
         WATCH(responsesSent);
         WATCH(bytesRcvd);
         WATCH(bytesSent);
+        WATCH(behaviorUpdates);
+        WATCH(requestsRejected);
     }
     else if (stage == INITSTAGE_APPLICATION_LAYER) {
         // 获取本地IP地址
@@ -76,7 +126,9 @@ void ModbusSlaveApp::loadConfigFromJson()
 
 void ModbusSlaveApp::parseJsonConfig(const json& j)
 {
-    // 查找与本地IP匹配的连接配置
+    // 查找与本地IP匹配的连接配置；网关模式下加载所有匹配条目
+    bool loaded = false;
+    std::bitset<256> unitIds;  // 网关模式下已加载的单元ID（跨条目及条目内）
     if (j.contains("connectArray") && j["connectArray"].is_array()) {
         for (const auto& connJson : j["connectArray"]) {
             if (connJson.contains("ipAddress") && matchLocalAddress(connJson["ipAddress"].get<std::string>())) {
@@ -94,6 +146,11 @@ void ModbusSlaveApp::parseJsonConfig(const json& j)
 
                     MSMapping& slave = newConn.slaves[slaveIndex];
                     slave.slaveId = slaveJson ["slaveId"];
+                    if (gatewayMode) {
+                        if (unitIds.test(slave.slaveId))
+                            throw cRuntimeError("Gateway unit ID %d is configured more than once", slave.slaveId);
+                        unitIds.set(slave.slaveId);
+                    }
                     slave.numBitGroup = slaveJson ["numBitGroup"];
                     slave.numInputBitGroup = slaveJson ["numInputBitGroup"];
                     slave.numRegisterGroup = slaveJson ["numRegisterGroup"];
@@ -114,14 +171,27 @@ void ModbusSlaveApp::parseJsonConfig(const json& j)
                 auto& connectArray = modbusStorage.getConnectArray();
                 connectArray.push_back(newConn);
                 modbusStorage.setNumConnect(connectArray.size());
+                modbusStorage.pack();
+
+                // 组已打包到arena后再解析寄存器行为，保证行为引用的组地址有效
+                slaveIndex = 0;
+                for (const auto& slaveJson : connJson["slaves"]) {
+                    if (slaveIndex >= newConn.numSlave) break;
+                    if (slaveJson.contains("behaviors"))
+                        loadBehaviors(&newConn.slaves[slaveIndex], slaveJson);
+                    slaveIndex++;
+                }
                 EV_INFO << "Successfully loaded config for IP: " << newConn.ipAddress << "numberConnect:" << modbusStorage.getNumConnect() << endl;
 
-                return; // 找到匹配配置后退出
+                loaded = true;
+                if (!gatewayMode)
+                    return; // 找到匹配配置后退出
             }
         }
     }
 
-    throw cRuntimeError("No matching IP configuration");
+    if (!loaded)
+        throw cRuntimeError("No matching IP configuration");
 }
 
 template <typename ElementType>
@@ -150,6 +220,191 @@ void ModbusSlaveApp::loadRegisterGroups(const json& jsonGroups, RegisterGroup<El
     }
 }
 
+void ModbusSlaveApp::loadBehaviors(MSMapping* slave, const json& slaveJson)
+{
+    const json& behaviorsJson = slaveJson["behaviors"];
+    if (!behaviorsJson.is_array())
+        throw cRuntimeError("Slave %d: behaviors must be an array", slave->slaveId);
+
+    SlaveBehaviors entry;
+    entry.slave = slave;
+    entry.interval = slaveJson.contains("updateInterval") ? SimTime(slaveJson["updateInterval"].get<double>()) : behaviorInterval;
+    if (entry.interval <= SIMTIME_ZERO)
+        throw cRuntimeError("Slave %d: updateInterval must be positive", slave->slaveId);
+
+    for (const auto& behaviorJson : behaviorsJson) {
+        std::unique_ptr<RegisterBehavior> behavior = RegisterBehavior::create(behaviorJson, getRNG(0));
+        // 行为作用的点必须完整落在某个已配置的组内
+        bool found = behavior->space == DISCRETE_INPUTS
+                ? ModbusStorage::findGroup<uint8_t>(*slave, DISCRETE_INPUTS, behavior->address, behavior->count) != nullptr
+                : ModbusStorage::findGroup<int16_t>(*slave, INPUT_REGISTERS, behavior->address, behavior->count) != nullptr;
+        if (!found)
+            throw cRuntimeError("Slave %d: behavior range %d..%d is not inside a configured group", slave->slaveId,
+                    behavior->address, behavior->address + behavior->count - 1);
+        entry.behaviors.push_back(std::move(behavior));
+    }
+    if (entry.behaviors.empty())
+        return;
+
+    slaveBehaviors.push_back(std::move(entry));
+    SlaveBehaviors& added = slaveBehaviors.back();
+    added.updateTimer = new cMessage("behaviorUpdate");
+    added.updateTimer->setContextPointer(&added);
+    scheduleAt(simTime(), added.updateTimer);  // 立即更新一次，使初始值符合行为
+    EV_INFO << "从站" << (int)slave->slaveId << "加载" << added.behaviors.size() << "个寄存器行为，更新周期" << added.interval << endl;
+}
+
+void ModbusSlaveApp::updateBehaviors(SlaveBehaviors& entry)
+{
+    MSMapping* slave = entry.slave;
+    double t = simTime().dbl();
+    for (auto& behavior : entry.behaviors) {
+        bool changed = false;
+        if (behavior->space == DISCRETE_INPUTS) {
+            RegisterGroup<uint8_t>* group = ModbusStorage::findGroup<uint8_t>(*slave, DISCRETE_INPUTS, behavior->address, behavior->count);
+            uint32_t offset = behavior->address - group->startAddress;
+            for (int i = 0; i < behavior->count; i++) {
+                uint8_t value = std::lround(behavior->valueAt(t, i)) != 0 ? 1 : 0;
+                if (ModbusStorage::getBit(*group, offset + i) != value) {
+                    ModbusStorage::setBit(*group, offset + i, value);
+                    changed = true;
+                    behaviorUpdates++;
+                }
+            }
+            recordWrite(slave, group, changed);
+        }
+        else {
+            RegisterGroup<int16_t>* group = ModbusStorage::findGroup<int16_t>(*slave, INPUT_REGISTERS, behavior->address, behavior->count);
+            int16_t* data = group->data + (behavior->address - group->startAddress);
+            for (int i = 0; i < behavior->count; i++) {
+                // 数值按16位寄存器截断：负数为有符号，超过32767的按无符号写入
+                long raw = std::min(65535L, std::max(-32768L, std::lround(behavior->valueAt(t, i))));
+                int16_t value = (int16_t)(uint16_t)raw;
+                if (data[i] != value) {
+                    data[i] = value;
+                    changed = true;
+                    behaviorUpdates++;
+                }
+            }
+            recordWrite(slave, group, changed);
+        }
+    }
+}
+
+void ModbusSlaveApp::parseServiceTimeTable(const char *spec)
+{
+    // 格式："功能码:时长"，以空格或逗号分隔，如 "3:5ms 16:12ms"
+    for (const std::string& entry : cStringTokenizer(spec, " ,").asVector()) {
+        size_t colon = entry.find(':');
+        if (colon == std::string::npos)
+            throw cRuntimeError("serviceTimeTable: entry '%s' must be functionCode:time", entry.c_str());
+        long functionCode = strtol(entry.substr(0, colon).c_str(), nullptr, 0);
+        if (functionCode < 1 || functionCode > 0x7F)
+            throw cRuntimeError("serviceTimeTable: invalid function code in '%s'", entry.c_str());
+        double serviceTime = cValue::parseQuantity(entry.substr(colon + 1).c_str(), "s");
+        if (serviceTime < 0)
+            throw cRuntimeError("serviceTimeTable: negative service time in '%s'", entry.c_str());
+        serviceTimeTable[functionCode] = serviceTime;
+    }
+}
+
+simtime_t ModbusSlaveApp::getSerialBusTime(const BytesChunk& pdu) const
+{
+    if (serialBaudRate <= 0)
+        return SIMTIME_ZERO;
+    // RTU帧 = 地址(1) + PDU + CRC(2)；响应长度按请求估算（异常响应按正常响应长度计）
+    const std::vector<uint8_t>& bytes = pdu.getBytes();
+    uint16_t quantity = bytes.size() >= 5 ? (bytes[3] << 8) | bytes[4] : 0;
+    size_t responseLength;
+    switch (bytes[0]) {
+        case 0x01: case 0x02: responseLength = 2 + (quantity + 7) / 8; break;
+        case 0x03: case 0x04: case 0x17: responseLength = 2 + 2 * quantity; break;
+        case 0x05: case 0x06: case 0x0F: case 0x10: responseLength = 5; break;
+        default: responseLength = 2; break;
+    }
+    double charTime = serialCharBits / serialBaudRate;
+    // 帧间隔3.5个字符，波特率高于19200时固定为1.75ms
+    double frameGap = serialBaudRate > 19200 ? 1.75e-3 : 3.5 * charTime;
+    size_t numChars = (1 + bytes.size() + 2) + (1 + responseLength + 2);
+    return numChars * charTime + 2 * frameGap;
+}
+
+simtime_t ModbusSlaveApp::getServiceTime(uint8_t functionCode)
+{
+    auto it = serviceTimeTable.find(functionCode);
+    if (it != serviceTimeTable.end())
+        return it->second;
+    // serviceTime为volatile参数，每个请求重新取值（可配置为分布）
+    simtime_t serviceTime = par("serviceTime");
+    return serviceTime < SIMTIME_ZERO ? SIMTIME_ZERO : serviceTime;
+}
+
+void ModbusSlaveApp::acceptRequest(const Ptr<const ModbusHeader>& header, const Ptr<const BytesChunk>& pduChunk, int connId)
+{
+    PendingRequest request;
+    request.header = header;
+    request.pdu = pduChunk;
+    request.connId = connId;
+    request.arrivalTime = simTime();
+
+    if ((int)inService.size() < concurrency)
+        startService(request);
+    else if (queueCapacity < 0 || (int)requestQueue.size() < queueCapacity) {
+        requestQueue.push_back(request);
+        emit(requestQueueLengthSignal, (long)requestQueue.size());
+    }
+    else {
+        // 队列已满：按Modbus规范回复异常码0x06（从站设备忙）
+        requestsRejected++;
+        EV_WARN << "请求队列已满，拒绝请求 transactionId=" << header->getTransactionId() << endl;
+        sendExceptionResponse(header, pduChunk->getByte(0), 0x06, connId);
+    }
+}
+
+void ModbusSlaveApp::startService(const PendingRequest& request)
+{
+    emit(queueingDelaySignal, simTime() - request.arrivalTime);
+    // 设备处理时间 + 串行总线上请求与响应的传输时间
+    simtime_t serviceTime = getServiceTime(request.pdu->getByte(0)) + getSerialBusTime(*request.pdu);
+    cMessage *timer = new cMessage("serviceDone");
+    inService[timer] = request;
+    scheduleAfter(serviceTime, timer);
+}
+
+void ModbusSlaveApp::completeService(cMessage *timer)
+{
+    auto it = inService.find(timer);
+    PendingRequest request = it->second;
+    inService.erase(it);
+    delete timer;
+
+    // 处理完成才生成响应；连接已关闭的请求直接丢弃
+    unsigned long allocationsBefore = allocationCounter ? allocationCounter() : 0;
+    if (request.connId != -1)
+        processModbusRequest(request.header, request.pdu->getBytes().data(), B(request.pdu->getChunkLength()).get(), request.connId);
+    if (allocationCounter)
+        allocationsCounted += allocationCounter() - allocationsBefore;
+
+    while ((int)inService.size() < concurrency && !requestQueue.empty()) {
+        PendingRequest next = requestQueue.front();
+        requestQueue.pop_front();
+        emit(requestQueueLengthSignal, (long)requestQueue.size());
+        startService(next);
+    }
+}
+
+void ModbusSlaveApp::dropRequests(int connId)
+{
+    size_t queued = requestQueue.size();
+    requestQueue.erase(std::remove_if(requestQueue.begin(), requestQueue.end(),
+            [connId](const PendingRequest& request) { return request.connId == connId; }), requestQueue.end());
+    if (requestQueue.size() != queued)
+        emit(requestQueueLengthSignal, (long)requestQueue.size());
+    for (auto& entry : inService)
+        if (entry.second.connId == connId)
+            entry.second.connId = -1;
+}
+
 bool ModbusSlaveApp::matchLocalAddress(const std::string& configIp)
 {
     L3Address configAddress = L3AddressResolver().resolve(configIp.c_str());
@@ -163,15 +418,34 @@ bool ModbusSlaveApp::matchLocalAddress(const std::string& configIp)
 
 void ModbusSlaveApp::handleMessage(cMessage *msg)
 {
-    if (msg->getKind() == TCP_I_PEER_CLOSED) {
+    if (msg->isSelfMessage()) {
+        if (inService.count(msg))
+            completeService(msg);
+        else {
+            // 寄存器行为定时器：批量更新该从站的所有行为后重新调度
+            SlaveBehaviors *entry = static_cast<SlaveBehaviors *>(msg->getContextPointer());
+            updateBehaviors(*entry);
+            scheduleAfter(entry->interval, msg);
+        }
+    }
+    else if (msg->getKind() == TCP_I_PEER_CLOSED) {
         // we'll close too, but only after there's surely no message
         // pending to be sent back in this connection
         int connId = check_and_cast<Indication *>(msg)->getTag<SocketInd>()->getSocketId();
         delete msg;
+        dropRequests(connId);
         auto request = new Request("close", TCP_C_CLOSE);
         request->addTag<SocketReq>()->setSocketId(connId);
         send(request, "socketOut");
     }
+    else if (msg->getKind() == TCP_I_CONNECTION_RESET || msg->getKind() == TCP_I_TIMED_OUT || msg->getKind() == TCP_I_CLOSED) {
+        // 连接已终止：丢弃该连接排队和处理中的请求，处理完成后不再向失效的socketId发送响应
+        int connId = check_and_cast<Indication *>(msg)->getTag<SocketInd>()->getSocketId();
+        delete msg;
+        dropRequests(connId);
+        socketQueue.erase(connId);
+        responseChunkPool.erase(connId);
+    }
     else if (msg->getKind() == TCP_I_DATA || msg->getKind() == TCP_I_URGENT_DATA) {
         Packet *packet = check_and_cast<Packet *>(msg);
         int connId = packet->getTag<SocketInd>()->getSocketId();
@@ -179,6 +453,9 @@ void ModbusSlaveApp::handleMessage(cMessage *msg)
         auto chunk = packet->peekDataAt(B(0), packet->getTotalLength());
         queue.push(chunk);
         emit(packetReceivedSignal, packet);
+        // 分配计数覆盖取出请求、处理和发送响应（含packetSent统计记录）
+        unsigned long allocationsBefore = allocationCounter ? allocationCounter() : 0;
+        long requestsBefore = requestsRcvd;
 
         while (queue.has<ModbusHeader>(b(-1))) {
             const auto& header = queue.pop<ModbusHeader>(b(-1));
@@ -208,17 +485,25 @@ void ModbusSlaveApp::handleMessage(cMessage *msg)
                 break;
             }
 
-            // 提取PDU数据
+            // 提取PDU数据（直接在chunk的字节数组上解析，不再复制）
             const auto& pduChunk = queue.pop<BytesChunk>(B(pduLength));
-            const std::vector<uint8_t> pduData = pduChunk->getBytes();
 
             bytesRcvd += B(pduChunk->getChunkLength()).get();
 
-            // 处理Modbus请求
-            processModbusRequest(header, pduData.data(), pduLength, connId);
-
-
-
+            // 处理Modbus请求（合并响应时先累积到txBuffer）；启用处理时延时先排队
+            batchConnId = coalesceResponses ? connId : -1;
+            if (serviceModelEnabled)
+                acceptRequest(header, pduChunk, connId);
+            else
+                processModbusRequest(header, pduChunk->getBytes().data(), pduLength, connId);
+        }
+        batchConnId = -1;
+        // 本次收到的数据处理完毕，合并的响应作为一个包发出
+        flushResponses();
+        if (allocationCounter && requestsRcvd > requestsBefore) {
+            unsigned long allocations = allocationCounter() - allocationsBefore;
+            allocationsCounted += allocations;
+            emit(allocationsPerRequestSignal, (double)allocations / (requestsRcvd - requestsBefore));
         }
         delete msg;
 
@@ -242,6 +527,11 @@ void ModbusSlaveApp::processModbusRequest(const Ptr<const ModbusHeader>& request
     }
 
     uint8_t functionCode = pduData[0];
+    // 网关后没有该单元：回复异常码0x0B（网关目标设备无响应）
+    if (gatewayMode && !modbusStorage.findSlave(requestHeader->getSlaveId())) {
+        sendExceptionResponse(requestHeader, functionCode, 0x0B, connId);
+        return;
+    }
     switch (functionCode) {
         case 0x01: handleReadCoils(requestHeader, pduData, pduLength, connId); break;
         case 0x02: handleReadDiscreteInputs(requestHeader, pduData, pduLength, connId); break;
@@ -256,77 +546,114 @@ void ModbusSlaveApp::processModbusRequest(const Ptr<const ModbusHeader>& request
     }
 }
 
-void ModbusSlaveApp::sendModbusResponse(const Ptr<const ModbusHeader>& requestHeader, const std::vector<uint8_t>& responsePdu, int connId)
+std::vector<uint8_t>& ModbusSlaveApp::prepareResponse(size_t length)
+{
+    responseBuffer.resize(length);
+    return responseBuffer;
+}
+
+void ModbusSlaveApp::sendModbusResponse(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* responsePdu, uint16_t responseLength, int connId)
 {
-    // 构建响应头部
-    auto responseHeader = makeShared<ModbusHeader>();
-    responseHeader->setTransactionId(requestHeader->getTransactionId());
-    responseHeader->setProtocolId(0);
-    responseHeader->setLength(1 + responsePdu.size()); // 1字节从站ID + PDU长度
-    responseHeader->setSlaveId(requestHeader->getSlaveId());
-    // 添加创建时间标签到头部chunk
-    responseHeader->addTag<CreationTimeTag>()->setCreationTime(simTime());
+    // 不同连接的响应不能合并到同一个包
+    if (!txBuffer.empty() && txConnId != connId)
+        flushResponses();
+    txConnId = connId;
+
+    // MBAP头：事务ID、协议ID(0)、长度(1字节从站ID + PDU长度)、从站ID，均为大端
+    uint16_t transactionId = requestHeader->getTransactionId();
+    uint16_t length = 1 + responseLength;
+    const uint8_t mbap[7] = {
+        uint8_t(transactionId >> 8), uint8_t(transactionId), 0, 0,
+        uint8_t(length >> 8), uint8_t(length), requestHeader->getSlaveId()
+    };
+    txBuffer.insert(txBuffer.end(), mbap, mbap + sizeof(mbap));
+    txBuffer.insert(txBuffer.end(), responsePdu, responsePdu + responseLength);
+    responsesSent++;
+
+    // 处于合并批次中时等处理完本次数据后再发送
+    if (connId != batchConnId)
+        flushResponses();
+}
+
+void ModbusSlaveApp::flushResponses()
+{
+    if (txBuffer.empty())
+        return;
 
-    // 构建响应包
-    Packet* responsePacket = new Packet("ModbusResponse", TCP_C_SEND);
-    responsePacket->addTag<SocketReq>()->setSocketId(connId);
-    responsePacket->insertAtBack(responseHeader);
-    auto pduChunk = makeShared<BytesChunk>();
-    pduChunk->setBytes(responsePdu);
-    // 为PDU chunk添加创建时间标签（冗余，增强兼容性）
-    pduChunk->addTag<CreationTimeTag>()->setCreationTime(simTime());
-    responsePacket->insertAtBack(pduChunk);
-    // 在Packet层也添加创建时间标签
-    responsePacket->addTag<CreationTimeTag>()->setCreationTime(simTime());
+    // 整个包只有一个chunk，创建时间标签覆盖全部响应字节，接收端dataAge照常计算
+    auto responseChunk = acquireResponseChunk(txConnId);
+    responseChunk->setBytes(txBuffer);
+    responseChunk->addTag<CreationTimeTag>()->setCreationTime(simTime());
+
+    auto responsePacket = new Packet("ModbusResponse", TCP_C_SEND);
+    responsePacket->addTag<SocketReq>()->setSocketId(txConnId);
+    responsePacket->insertAtBack(responseChunk);
+    txBuffer.clear();
+    txConnId = -1;
+    sendResponsePacket(responsePacket);
+}
+
+Ptr<BytesChunk> ModbusSlaveApp::acquireResponseChunk(int connId)
+{
+    // 只被池引用的chunk已被TCP和主站释放，可以改写后再次发送
+    auto& pool = responseChunkPool[connId];
+    for (auto& chunk : pool) {
+        if (chunk.use_count() == 1) {
+            chunk->markMutableIfExclusivelyOwned();
+            chunk->clearTags();
+            return chunk;
+        }
+    }
+    // 池中的chunk都还在传输中：新建一个，池未满时留作复用
+    auto chunk = makeShared<BytesChunk>();
+    if (pool.size() < RESPONSE_POOL_SIZE)
+        pool.push_back(chunk);
+    return chunk;
+}
 
+void ModbusSlaveApp::sendResponsePacket(Packet *responsePacket)
+{
     auto& tags = check_and_cast<ITaggedObject *>(responsePacket)->getTags();
     tags.addTagIfAbsent<DispatchProtocolReq>()->setProtocol(&Protocol::tcp);
 
-    // 发送响应
-    send(responsePacket, "socketOut");
     bytesSent += responsePacket->getTotalLength().get();
-    responsesSent++;
     emit(packetSentSignal, responsePacket);
+    send(responsePacket, "socketOut");
 }
 
 void ModbusSlaveApp::sendExceptionResponse(const Ptr<const ModbusHeader>& requestHeader, uint8_t functionCode, uint8_t exceptionCode, int connId)
 {
-    std::vector<uint8_t> exceptionPdu;
-    exceptionPdu.push_back(functionCode | 0x80); // 异常功能码（最高位置1）
-    exceptionPdu.push_back(exceptionCode);       // 异常代码
+    uint8_t exceptionPdu[2];
+    exceptionPdu[0] = functionCode | 0x80; // 异常功能码（最高位置1）
+    exceptionPdu[1] = exceptionCode;       // 异常代码
 
-    sendModbusResponse(requestHeader, exceptionPdu, connId);
+    sendModbusResponse(requestHeader, exceptionPdu, sizeof(exceptionPdu), connId);
 }
 
 MSMapping* ModbusSlaveApp::findSlave(uint8_t slaveId)
 {
-    const auto& connectArray = modbusStorage.getConnectArray();
-    for (const auto& conn : connectArray) {
-        for (int i = 0; i < conn.numSlave; i++) {
-            if (conn.slaves[i].slaveId == slaveId) {
-                return const_cast<MSMapping*>(&conn.slaves[i]);
-            }
-        }
-    }
-    EV_INFO <<"查找从站失败" << endl;
-    return nullptr;
+    MSMapping* slave = modbusStorage.findSlave(slaveId);
+    if (!slave)
+        EV_INFO <<"查找从站失败" << endl;
+    return slave;
 }
 
 template <typename ElementType>
-RegisterGroup<ElementType>* ModbusSlaveApp::findRegisterGroup(RegisterGroup<ElementType>* groups, int numGroups, uint16_t startAddress, uint16_t quantity)
+void ModbusSlaveApp::recordWrite(MSMapping* slave, RegisterGroup<ElementType>* group, bool changed)
 {
-    if (!groups || numGroups == 0) return nullptr;
-    uint16_t endAddress = startAddress + quantity - 1;
+    int connIdx = -1;
+    modbusStorage.findSlave(slave->slaveId, &connIdx);
+    modbusStorage.touchGroup(connIdx, *slave, *group, changed, simTime());
+}
 
-    for (int i = 0; i < numGroups; i++) {
-        auto& group = groups[i];
-        uint16_t groupEnd = group.startAddress + group.number - 1;
-        if (startAddress >= group.startAddress && endAddress <= groupEnd) {
-            return &group;
-        }
-    }
-    EV_INFO <<"查找寄存器组失败" << endl;
-    return nullptr;
+template <typename ElementType>
+RegisterGroup<ElementType>* ModbusSlaveApp::findRegisterGroup(MSMapping* slave, AddressSpace space, uint16_t startAddress, uint16_t quantity)
+{
+    // 加载配置时已建立地址索引，二分查找完整包含请求范围的组
+    RegisterGroup<ElementType>* group = ModbusStorage::findGroup<ElementType>(*slave, space, startAddress, quantity);
+    if (!group)
+        EV_INFO <<"查找寄存器组失败" << endl;
+    return group;
 }
 
 void ModbusSlaveApp::handleReadCoils(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId)
@@ -353,32 +680,20 @@ void ModbusSlaveApp::handleReadCoils(const Ptr<const ModbusHeader>& requestHeade
         return;
     }
 
-    auto coilGroup = findRegisterGroup(slave->bitGroup, slave->numBitGroup, startAddr, quantity);
+    auto coilGroup = findRegisterGroup<uint8_t>(slave, COILS, startAddr, quantity);
     if (!coilGroup) {
         sendExceptionResponse(requestHeader, 0x01, 0x02, connId);
         return;
     }
 
     // 构建响应数据
-    std::vector<uint8_t> responsePdu;
-    responsePdu.push_back(0x01);
     uint8_t byteCount = (quantity + 7) / 8;
-    responsePdu.push_back(byteCount);
-
-    uint8_t currentByte = 0;
-    int bitPos = 0;
-    for (uint16_t i = 0; i < quantity; i++) {
-        uint16_t idx = startAddr + i - coilGroup->startAddress;
-        currentByte |= (coilGroup->data[idx] & 0x01) << bitPos++;
-        if (bitPos >= 8) {
-            responsePdu.push_back(currentByte);
-            currentByte = 0;
-            bitPos = 0;
-        }
-    }
-    if (bitPos > 0) responsePdu.push_back(currentByte);
+    std::vector<uint8_t>& responsePdu = prepareResponse(2 + byteCount);
+    responsePdu[0] = 0x01;
+    responsePdu[1] = byteCount;
+    ModbusStorage::readBits(*coilGroup, startAddr - coilGroup->startAddress, quantity, responsePdu.data() + 2);
 
-    sendModbusResponse(requestHeader, responsePdu, connId);
+    sendModbusResponse(requestHeader, responsePdu.data(), responsePdu.size(), connId);
 }
 
 void ModbusSlaveApp::handleReadDiscreteInputs(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId)
@@ -405,32 +720,20 @@ void ModbusSlaveApp::handleReadDiscreteInputs(const Ptr<const ModbusHeader>& req
         return;
     }
 
-    auto inputGroup = findRegisterGroup(slave->inputBitGroup, slave->numInputBitGroup, startAddr, quantity);
+    auto inputGroup = findRegisterGroup<uint8_t>(slave, DISCRETE_INPUTS, startAddr, quantity);
     if (!inputGroup) {
         sendExceptionResponse(requestHeader, 0x02, 0x02, connId);
         return;
     }
 
     // 构建响应数据（与读线圈逻辑相同）
-    std::vector<uint8_t> responsePdu;
-    responsePdu.push_back(0x02);
     uint8_t byteCount = (quantity + 7) / 8;
-    responsePdu.push_back(byteCount);
-
-    uint8_t currentByte = 0;
-    int bitPos = 0;
-    for (uint16_t i = 0; i < quantity; i++) {
-        uint16_t idx = startAddr + i - inputGroup->startAddress;
-        currentByte |= (inputGroup->data[idx] & 0x01) << bitPos++;
-        if (bitPos >= 8) {
-            responsePdu.push_back(currentByte);
-            currentByte = 0;
-            bitPos = 0;
-        }
-    }
-    if (bitPos > 0) responsePdu.push_back(currentByte);
+    std::vector<uint8_t>& responsePdu = prepareResponse(2 + byteCount);
+    responsePdu[0] = 0x02;
+    responsePdu[1] = byteCount;
+    ModbusStorage::readBits(*inputGroup, startAddr - inputGroup->startAddress, quantity, responsePdu.data() + 2);
 
-    sendModbusResponse(requestHeader, responsePdu, connId);
+    sendModbusResponse(requestHeader, responsePdu.data(), responsePdu.size(), connId);
 }
 
 void ModbusSlaveApp::handleReadHoldingRegisters(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId)
@@ -457,25 +760,19 @@ void ModbusSlaveApp::handleReadHoldingRegisters(const Ptr<const ModbusHeader>& r
         return;
     }
 
-    auto regGroup = findRegisterGroup(slave->registerGroup, slave->numRegisterGroup, startAddr, quantity);
+    auto regGroup = findRegisterGroup<int16_t>(slave, HOLDING_REGISTERS, startAddr, quantity);
     if (!regGroup) {
         sendExceptionResponse(requestHeader, 0x03, 0x02, connId);
         return;
     }
 
     // 构建响应数据
-    std::vector<uint8_t> responsePdu;
-    responsePdu.push_back(0x03);
-    responsePdu.push_back(quantity * 2); // 每个寄存器2字节
+    std::vector<uint8_t>& responsePdu = prepareResponse(2 + quantity * 2);
+    responsePdu[0] = 0x03;
+    responsePdu[1] = quantity * 2; // 每个寄存器2字节
+    encodeRegisters(responsePdu.data() + 2, regGroup->data + (startAddr - regGroup->startAddress), quantity);
 
-    for (uint16_t i = 0; i < quantity; i++) {
-        uint16_t idx = startAddr + i - regGroup->startAddress;
-        uint16_t value = regGroup->data[idx];
-        responsePdu.push_back((value >> 8) & 0xFF);
-        responsePdu.push_back(value & 0xFF);
-    }
-
-    sendModbusResponse(requestHeader, responsePdu, connId);
+    sendModbusResponse(requestHeader, responsePdu.data(), responsePdu.size(), connId);
 }
 
 void ModbusSlaveApp::handleReadInputRegisters(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId)
@@ -502,25 +799,19 @@ void ModbusSlaveApp::handleReadInputRegisters(const Ptr<const ModbusHeader>& req
         return;
     }
 
-    auto regGroup = findRegisterGroup(slave->inputRegisterGroup, slave->numInputRegisterGroup, startAddr, quantity);
+    auto regGroup = findRegisterGroup<int16_t>(slave, INPUT_REGISTERS, startAddr, quantity);
     if (!regGroup) {
         sendExceptionResponse(requestHeader, 0x04, 0x02, connId);
         return;
     }
 
     // 构建响应数据（与读保持寄存器逻辑相同）
-    std::vector<uint8_t> responsePdu;
-    responsePdu.push_back(0x04);
-    responsePdu.push_back(quantity * 2);
-
-    for (uint16_t i = 0; i < quantity; i++) {
-        uint16_t idx = startAddr + i - regGroup->startAddress;
-        uint16_t value = regGroup->data[idx];
-        responsePdu.push_back((value >> 8) & 0xFF);
-        responsePdu.push_back(value & 0xFF);
-    }
+    std::vector<uint8_t>& responsePdu = prepareResponse(2 + quantity * 2);
+    responsePdu[0] = 0x04;
+    responsePdu[1] = quantity * 2;
+    encodeRegisters(responsePdu.data() + 2, regGroup->data + (startAddr - regGroup->startAddress), quantity);
 
-    sendModbusResponse(requestHeader, responsePdu, connId);
+    sendModbusResponse(requestHeader, responsePdu.data(), responsePdu.size(), connId);
 }
 
 void ModbusSlaveApp::handleWriteSingleCoil(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId)
@@ -547,7 +838,7 @@ void ModbusSlaveApp::handleWriteSingleCoil(const Ptr<const ModbusHeader>& reques
         return;
     }
 
-    auto coilGroup = findRegisterGroup(slave->bitGroup, slave->numBitGroup, coilAddr, 1);
+    auto coilGroup = findRegisterGroup<uint8_t>(slave, COILS, coilAddr, 1);
     if (!coilGroup) {
         sendExceptionResponse(requestHeader, 0x05, 0x02, connId);
         return;
@@ -555,11 +846,13 @@ void ModbusSlaveApp::handleWriteSingleCoil(const Ptr<const ModbusHeader>& reques
 
     // 写入线圈值
     uint16_t idx = coilAddr - coilGroup->startAddress;
-    coilGroup->data[idx] = (value == 0xFF00) ? 1 : 0;
+    uint8_t bitValue = (value == 0xFF00) ? 1 : 0;
+    bool changed = ModbusStorage::getBit(*coilGroup, idx) != bitValue;
+    ModbusStorage::setBit(*coilGroup, idx, bitValue);
+    recordWrite(slave, coilGroup, changed);
 
     // 响应PDU与请求PDU相同
-    std::vector<uint8_t> responsePdu(pduData, pduData + pduLength);
-    sendModbusResponse(requestHeader, responsePdu, connId);
+    sendModbusResponse(requestHeader, pduData, pduLength, connId);
 }
 
 void ModbusSlaveApp::handleWriteSingleRegister(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId)
@@ -580,7 +873,7 @@ void ModbusSlaveApp::handleWriteSingleRegister(const Ptr<const ModbusHeader>& re
         return;
     }
 
-    auto regGroup = findRegisterGroup(slave->registerGroup, slave->numRegisterGroup, regAddr, 1);
+    auto regGroup = findRegisterGroup<int16_t>(slave, HOLDING_REGISTERS, regAddr, 1);
     if (!regGroup) {
         sendExceptionResponse(requestHeader, 0x06, 0x02, connId);
         return;
@@ -588,11 +881,12 @@ void ModbusSlaveApp::handleWriteSingleRegister(const Ptr<const ModbusHeader>& re
 
     // 写入寄存器值
     uint16_t idx = regAddr - regGroup->startAddress;
+    bool changed = regGroup->data[idx] != int16_t(value);
     regGroup->data[idx] = value;
+    recordWrite(slave, regGroup, changed);
 
     // 响应PDU与请求PDU相同
-    std::vector<uint8_t> responsePdu(pduData, pduData + pduLength);
-    sendModbusResponse(requestHeader, responsePdu, connId);
+    sendModbusResponse(requestHeader, pduData, pduLength, connId);
 }
 
 void ModbusSlaveApp::handleWriteMultipleCoils(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId)
@@ -626,29 +920,18 @@ void ModbusSlaveApp::handleWriteMultipleCoils(const Ptr<const ModbusHeader>& req
         return;
     }
 
-    auto coilGroup = findRegisterGroup(slave->bitGroup, slave->numBitGroup, startAddr, quantity);
+    auto coilGroup = findRegisterGroup<uint8_t>(slave, COILS, startAddr, quantity);
     if (!coilGroup) {
         sendExceptionResponse(requestHeader, 0x0F, 0x02, connId);
         return;
     }
 
     // 写入线圈值
-    for (uint16_t i = 0; i < quantity; i++) {
-        uint16_t idx = startAddr + i - coilGroup->startAddress;
-        uint8_t bytePos = i / 8;
-        uint8_t bitPos = i % 8;
-        coilGroup->data[idx] = (pduData[6 + bytePos] >> bitPos) & 0x01;
-    }
-
-    // 响应PDU：功能码 + 起始地址 + 数量
-    std::vector<uint8_t> responsePdu;
-    responsePdu.push_back(0x0F);
-    responsePdu.push_back((startAddr >> 8) & 0xFF);
-    responsePdu.push_back(startAddr & 0xFF);
-    responsePdu.push_back((quantity >> 8) & 0xFF);
-    responsePdu.push_back(quantity & 0xFF);
+    bool changed = ModbusStorage::storeBits(*coilGroup, startAddr - coilGroup->startAddress, pduData + 6, 0, quantity);
+    recordWrite(slave, coilGroup, changed);
 
-    sendModbusResponse(requestHeader, responsePdu, connId);
+    // 响应PDU：功能码 + 起始地址 + 数量（即请求PDU的前5字节）
+    sendModbusResponse(requestHeader, pduData, 5, connId);
 }
 
 void ModbusSlaveApp::handleWriteMultipleRegisters(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId)
@@ -682,28 +965,18 @@ void ModbusSlaveApp::handleWriteMultipleRegisters(const Ptr<const ModbusHeader>&
         return;
     }
 
-    auto regGroup = findRegisterGroup(slave->registerGroup, slave->numRegisterGroup, startAddr, quantity);
+    auto regGroup = findRegisterGroup<int16_t>(slave, HOLDING_REGISTERS, startAddr, quantity);
     if (!regGroup) {
         sendExceptionResponse(requestHeader, 0x10, 0x02, connId);
         return;
     }
 
     // 写入寄存器值
-    for (uint16_t i = 0; i < quantity; i++) {
-        uint16_t idx = startAddr + i - regGroup->startAddress;
-        uint16_t value = ntohs(*(const uint16_t*)(pduData + 6 + 2*i));
-        regGroup->data[idx] = value;
-    }
+    bool changed = ModbusStorage::storeRegisters(*regGroup, startAddr - regGroup->startAddress, pduData + 6, quantity);
+    recordWrite(slave, regGroup, changed);
 
-    // 响应PDU：功能码 + 起始地址 + 数量
-    std::vector<uint8_t> responsePdu;
-    responsePdu.push_back(0x10);
-    responsePdu.push_back((startAddr >> 8) & 0xFF);
-    responsePdu.push_back(startAddr & 0xFF);
-    responsePdu.push_back((quantity >> 8) & 0xFF);
-    responsePdu.push_back(quantity & 0xFF);
-
-    sendModbusResponse(requestHeader, responsePdu, connId);
+    // 响应PDU：功能码 + 起始地址 + 数量（即请求PDU的前5字节）
+    sendModbusResponse(requestHeader, pduData, 5, connId);
 }
 
 void ModbusSlaveApp::handleReadWriteMultipleRegisters(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId)
@@ -744,35 +1017,27 @@ void ModbusSlaveApp::handleReadWriteMultipleRegisters(const Ptr<const ModbusHead
     }
 
     // 先进行写寄存器
-    auto writeGroup = findRegisterGroup(slave->registerGroup, slave->numRegisterGroup, writeStart, writeQty);
+    auto writeGroup = findRegisterGroup<int16_t>(slave, HOLDING_REGISTERS, writeStart, writeQty);
     if (!writeGroup) {
         sendExceptionResponse(requestHeader, 0x17, 0x02, connId);
         return;
     }
-    for (uint16_t i = 0; i < writeQty; i++) {
-        uint16_t idx = writeStart + i - writeGroup->startAddress;
-        uint16_t value = ntohs(*(const uint16_t*)(pduData + 10 + 2*i));
-        writeGroup->data[idx] = value;
-    }
+    bool changed = ModbusStorage::storeRegisters(*writeGroup, writeStart - writeGroup->startAddress, pduData + 10, writeQty);
+    recordWrite(slave, writeGroup, changed);
 
     // 再读取寄存器并构造响应（读保持寄存器语义）
-    auto readGroup = findRegisterGroup(slave->registerGroup, slave->numRegisterGroup, readStart, readQty);
+    auto readGroup = findRegisterGroup<int16_t>(slave, HOLDING_REGISTERS, readStart, readQty);
     if (!readGroup) {
         sendExceptionResponse(requestHeader, 0x17, 0x02, connId);
         return;
     }
 
-    std::vector<uint8_t> responsePdu;
-    responsePdu.push_back(0x17);
-    responsePdu.push_back(readQty * 2); // 字节数
-    for (uint16_t i = 0; i < readQty; i++) {
-        uint16_t idx = readStart + i - readGroup->startAddress;
-        uint16_t value = readGroup->data[idx];
-        responsePdu.push_back((value >> 8) & 0xFF);
-        responsePdu.push_back(value & 0xFF);
-    }
+    std::vector<uint8_t>& responsePdu = prepareResponse(2 + readQty * 2);
+    responsePdu[0] = 0x17;
+    responsePdu[1] = readQty * 2; // 字节数
+    encodeRegisters(responsePdu.data() + 2, readGroup->data + (readStart - readGroup->startAddress), readQty);
 
-    sendModbusResponse(requestHeader, responsePdu, connId);
+    sendModbusResponse(requestHeader, responsePdu.data(), responsePdu.size(), connId);
 }
 
 void ModbusSlaveApp::refreshDisplay() const
@@ -794,6 +1059,12 @@ void ModbusSlaveApp::finish()
             << "Responses sent: " << responsesSent << endl;
     EV_INFO << "Bytes received: " << bytesRcvd << ", "
             << "Bytes sent: " << bytesSent << endl;
+    if (!slaveBehaviors.empty())
+        recordScalar("behaviorUpdates", behaviorUpdates);
+    if (serviceModelEnabled)
+        recordScalar("requestsRejected", requestsRejected);
+    if (allocationCounter)
+        recordScalar("meanAllocationsPerRequest", requestsRcvd > 0 ? (double)allocationsCounted / requestsRcvd : 0);
 }
 
 } // namespace inet
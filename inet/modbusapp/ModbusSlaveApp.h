@@ -11,8 +11,12 @@
 
 #include "inet/common/lifecycle/LifecycleUnsupported.h"
 #include "inet/common/packet/ChunkQueue.h"
+#include "inet/common/packet/chunk/BytesChunk.h"
 #include "inet/transportlayer/contract/tcp/TcpSocket.h"
+#include <deque>
+#include <list>
 #include <nlohmann/json.hpp>
+#include "ModbusBehavior.h"
 #include "ModbusHeader_m.h"
 #include "ModbusStorage.h"
 
@@ -23,6 +27,26 @@ namespace inet {
 class INET_API ModbusSlaveApp : public cSimpleModule, public LifecycleUnsupported
 {
   protected:
+    // 一个从站的寄存器行为：所有行为共用一个定时器，到期时批量更新
+    struct SlaveBehaviors {
+        MSMapping* slave = nullptr;
+        std::vector<std::unique_ptr<RegisterBehavior>> behaviors;
+        simtime_t interval;
+        cMessage *updateTimer = nullptr;  // 上下文指针指向本结构
+    };
+
+    // 等待或正在处理的请求（设备处理时延模型）
+    struct PendingRequest {
+        Ptr<const ModbusHeader> header;
+        Ptr<const BytesChunk> pdu;
+        int connId = -1;          // 连接关闭后置为-1，处理完成时丢弃
+        simtime_t arrivalTime;
+    };
+
+    static simsignal_t queueingDelaySignal;
+    static simsignal_t requestQueueLengthSignal;
+    static simsignal_t allocationsPerRequestSignal;
+
     TcpSocket socket;
     ModbusStorage modbusStorage;  // 存储Modbus从站配置
     std::string slavesConfigPath;   // JSON配置文件路径
@@ -36,6 +60,39 @@ class INET_API ModbusSlaveApp : public cSimpleModule, public LifecycleUnsupporte
     long bytesSent = 0;
 
     std::map<int, ChunkQueue> socketQueue;  // 按连接ID管理数据队列
+    std::vector<uint8_t> responseBuffer;    // 复用的响应PDU缓冲区，避免每个请求重新分配
+
+    // 响应合并：处理同一个TCP_I_DATA期间产生的响应追加到txBuffer，处理完后一次发送
+    bool coalesceResponses = false;
+    int batchConnId = -1;                   // 正在合并响应的连接，-1表示不合并
+
+    // 响应发送：MBAP头和PDU直接写入复用的txBuffer，发送时复制进该连接池中空闲的BytesChunk
+    static const size_t RESPONSE_POOL_SIZE = 8;  // 每个连接最多保留的响应chunk数
+    std::vector<uint8_t> txBuffer;               // 尚未发送的响应ADU
+    int txConnId = -1;                           // txBuffer中响应所属的连接
+    std::map<int, std::vector<Ptr<BytesChunk>>> responseChunkPool;  // 按连接ID复用的响应chunk
+
+    // 分配计数（countAllocations=true，需预加载bench/AllocationCounter）
+    unsigned long (*allocationCounter)() = nullptr;  // 进程内operator new调用次数
+    unsigned long allocationsCounted = 0;            // 请求处理路径上的分配次数
+
+    simtime_t behaviorInterval;                 // 行为默认更新周期
+    std::list<SlaveBehaviors> slaveBehaviors;   // 用list保证定时器上下文指针稳定
+    long behaviorUpdates = 0;                   // 因行为更新而变化的点数
+
+    // 设备处理时延：serviceTime为0且无按功能码配置时不启用，请求收到即响应
+    bool serviceModelEnabled = false;
+    std::map<uint8_t, simtime_t> serviceTimeTable;  // 按功能码覆盖serviceTime
+    int concurrency = 1;                            // 同时处理的请求数上限
+    int queueCapacity = -1;                         // 等待队列容量，-1表示不限
+    std::deque<PendingRequest> requestQueue;        // 等待处理的请求（FIFO）
+    std::map<cMessage *, PendingRequest> inService; // 处理完成定时器 -> 正在处理的请求
+    long requestsRejected = 0;                      // 队列满时以“从站设备忙”拒绝的请求数
+
+    // 网关模式：加载所有匹配本机地址的connect条目，按单元ID直接查表分发
+    bool gatewayMode = false;
+    double serialBaudRate = 0;                      // 网关后串行总线的波特率，0表示不模拟总线
+    int serialCharBits = 11;                        // 串行线上每个字符的位数
 
   protected:
     virtual void initialize(int stage) override;
@@ -51,15 +108,35 @@ class INET_API ModbusSlaveApp : public cSimpleModule, public LifecycleUnsupporte
     void loadRegisterGroups(const json& jsonGroups, RegisterGroup<ElementType>*& groups, int count);
     virtual bool matchLocalAddress(const std::string& configIp);
 
+    // 寄存器行为：按从站配置的behaviors数组创建行为，定时批量更新输入寄存器/离散输入
+    virtual void loadBehaviors(MSMapping* slave, const json& slaveJson);
+    virtual void updateBehaviors(SlaveBehaviors& entry);
+
+    // 设备处理时延模型：排队、按并发上限开始处理、处理完成后生成响应
+    virtual void parseServiceTimeTable(const char *spec);
+    virtual simtime_t getServiceTime(uint8_t functionCode);
+    virtual simtime_t getSerialBusTime(const BytesChunk& pdu) const;
+    virtual void acceptRequest(const Ptr<const ModbusHeader>& header, const Ptr<const BytesChunk>& pduChunk, int connId);
+    virtual void startService(const PendingRequest& request);
+    virtual void completeService(cMessage *timer);
+    virtual void dropRequests(int connId);
+
     // Modbus消息处理核心方法
     virtual void processModbusRequest(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId);
-    virtual void sendModbusResponse(const Ptr<const ModbusHeader>& requestHeader, const std::vector<uint8_t>& responsePdu, int connId);
+    virtual std::vector<uint8_t>& prepareResponse(size_t length);
+    virtual void sendModbusResponse(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* responsePdu, uint16_t responseLength, int connId);
+    virtual void flushResponses();
+    virtual Ptr<BytesChunk> acquireResponseChunk(int connId);
+    virtual void sendResponsePacket(Packet *responsePacket);
     virtual void sendExceptionResponse(const Ptr<const ModbusHeader>& requestHeader, uint8_t functionCode, uint8_t exceptionCode, int connId);
 
     // 辅助查找方法
     virtual MSMapping* findSlave(uint8_t slaveId);
     template <typename ElementType>
-    RegisterGroup<ElementType>* findRegisterGroup(RegisterGroup<ElementType>* groups, int numGroups, uint16_t startAddress, uint16_t quantity);
+    RegisterGroup<ElementType>* findRegisterGroup(MSMapping* slave, AddressSpace space, uint16_t startAddress, uint16_t quantity);
+    // 写请求处理后记录刷新时间，数值有变化时更新组版本
+    template <typename ElementType>
+    void recordWrite(MSMapping* slave, RegisterGroup<ElementType>* group, bool changed);
 
     // 功能码处理方法
     virtual void handleReadCoils(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId);
@@ -71,6 +148,9 @@ class INET_API ModbusSlaveApp : public cSimpleModule, public LifecycleUnsupporte
     virtual void handleWriteMultipleCoils(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId);
     virtual void handleWriteMultipleRegisters(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId);
     virtual void handleReadWriteMultipleRegisters(const Ptr<const ModbusHeader>& requestHeader, const uint8_t* pduData, uint16_t pduLength, int connId);
+
+  public:
+    virtual ~ModbusSlaveApp();
 };
 
 } // namespace inet
@@ -7,13 +7,21 @@
 #ifndef __INET_MODBUSSTORAGE_H
 #define __INET_MODBUSSTORAGE_H
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <new>
+#include <type_traits>
 #include <string>
 #include <vector>
 #include "inet/networklayer/common/L3Address.h"
+#include "ModbusCodec.h"
 #include <arpa/inet.h> // 用于htonl、htons等字节序转换函数
 #include <nlohmann/json.hpp>
 #include <fstream>
 #include <iomanip>  // 用于std::setw
+#include <map>
+#include <unordered_map>
 #include "nlohmann/ordered_map.hpp"  // 引入有序映射支持
 
 // 定义有序JSON类型（确保字段顺序与写入顺序一致）
@@ -28,7 +36,21 @@ template <typename ElementType>
 struct RegisterGroup {
     uint16_t startAddress;  // 寄存器组起始地址（Modbus协议地址，如线圈地址0x0000）
     uint16_t number;        // 该组内元素总数（如10个线圈、20个保持寄存器）
-    ElementType* data;      // 数据数组指针（动态分配，长度 = number，需手动释放）
+    ElementType* data;      // 数据数组指针（长度 = number；紧凑存储时指向所属从站arena内部）
+    double scanInterval = 0; // 主站轮询周期（秒，JSON可选字段；0表示沿用从站或全局readInterval）
+    uint32_t offset = 0;    // 紧凑存储时数据在所属从站arena中的字节偏移
+    uint64_t version = 0;   // 变更版本：组内数据最近一次发生变化时ModbusStorage的generation（0表示加载后未变化）
+    simtime_t lastUpdate = SIMTIME_ZERO; // 最近一次被响应/写请求刷新的仿真时间（无论数值是否变化）
+    bool bitPacked = false; // 位压缩存储（仅线圈/离散输入）：data为(number+7)/8字节，低位在前，与Modbus报文布局一致；须经getBit/setBit/readBits/writeBits访问
+};
+
+// Modbus四类地址空间
+enum AddressSpace {
+    COILS = 0,             // 线圈（bitGroup）
+    DISCRETE_INPUTS,       // 离散输入（inputBitGroup）
+    HOLDING_REGISTERS,     // 保持寄存器（registerGroup）
+    INPUT_REGISTERS,       // 输入寄存器（inputRegisterGroup）
+    NUM_ADDRESS_SPACES
 };
 
 // -----------------------------------------------------------------------------
@@ -44,6 +66,11 @@ struct MSMapping {
     RegisterGroup<uint8_t>* inputBitGroup;    // 离散输入组数组指针（长度 = numInputBitGroup）
     RegisterGroup<int16_t>* registerGroup;    // 保持寄存器组数组指针（长度 = numRegisterGroup）
     RegisterGroup<int16_t>* inputRegisterGroup; // 输入寄存器组数组指针（长度 = numInputRegisterGroup）
+    double scanInterval = 0;                  // 主站轮询周期（秒，JSON可选字段；0表示沿用全局readInterval）
+    uint8_t* arena = nullptr;                 // 紧凑存储：四类寄存器组描述符及数据所在的连续内存块（非空时各组指针均指向其内部）
+    size_t arenaSize = 0;                     // arena字节数
+    uint64_t version = 0;                     // 该从站任一寄存器组的最新变更版本
+    const uint16_t* groupIndex[NUM_ADDRESS_SPACES] = {}; // 地址索引：各地址空间按startAddress排序的组下标（位于arena内；未打包或组地址重叠时为空，退化为线性查找）
 };
 
 // -----------------------------------------------------------------------------
@@ -54,6 +81,7 @@ struct connect {
     L3Address  ipAddress;     // Modbus服务器IP地址（如"192.168.1.10"）
     int numSlave;              // 该服务器下挂载的从站总数
     MSMapping* slaves;         // 从站数组指针（动态分配，长度 = numSlave，需手动释放）
+    uint64_t version = 0;      // 该连接下任一从站的最新变更版本
 };
 
 // -----------------------------------------------------------------------------
@@ -64,12 +92,24 @@ protected:
     int numconnect;                     // 配置的Modbus服务器连接总数（与connectArray.size()同步）
     std::vector<connect> connectArray;  // 动态连接数组（存储所有Modbus服务器连接配置）
 
+    // 查找索引（由reindex()根据connectArray重建；同一键重复出现时与线性查找一致，取第一个）
+    typedef std::array<int16_t, 256> SlaveTable;  // slaveId → 连接内从站下标，-1表示不存在
+    std::unordered_map<int, int> socketIndex;     // socketId → 连接下标
+    std::map<L3Address, int> ipIndex;             // IP地址 → 连接下标
+    std::vector<SlaveTable> slaveTables;          // 每个连接的slaveId直接查找表
+    std::array<int32_t, 256> anySlaveIndex;       // slaveId → (连接下标 << 16 | 从站下标)，跨所有连接，-1表示不存在
+
+    bool bitPackedCoils = false;  // pack()时是否将线圈/离散输入按位压缩存储
+    uint64_t generation = 0;      // 全局变更计数：每次有寄存器组数据变化时递增
+    bool snapshotBase = false;    // 作为快照副本时：是否持有带版本的全量快照，可据此请求增量
+    uint64_t structureVersion = 0; // 结构变更计数：连接/从站配置或socketId变化（重建索引）时递增
+
 public:
     // ------------------------------
     // 构造与析构（内存安全管理）
     // ------------------------------
     // 默认构造函数：初始化空连接集合
-    ModbusStorage() : numconnect(0) {}
+    ModbusStorage() : numconnect(0) { anySlaveIndex.fill(-1); }
 
     // 带参构造函数：指定初始连接数
     explicit ModbusStorage(int initNumConnect) {
@@ -87,6 +127,16 @@ public:
             if (conn.slaves != nullptr) {
                 for (int slaveIdx = 0; slaveIdx < conn.numSlave; slaveIdx++) {
                     MSMapping& currSlave = conn.slaves[slaveIdx];
+                    if (currSlave.arena != nullptr) {
+                        // 紧凑存储：描述符和数据都在arena中，一次释放
+                        delete[] currSlave.arena;
+                        currSlave.arena = nullptr;
+                        for (auto& index : currSlave.groupIndex)
+                            index = nullptr;
+                        currSlave.bitGroup = currSlave.inputBitGroup = nullptr;
+                        currSlave.registerGroup = currSlave.inputRegisterGroup = nullptr;
+                        continue;
+                    }
                     // 释放线圈组
                     if (currSlave.bitGroup != nullptr) {
                         for (int i = 0; i < currSlave.numBitGroup; ++i) {
@@ -126,6 +176,7 @@ public:
         }
         connectArray.clear();
         numconnect = 0;
+        reindex();
     }
 
     // ------------------------------
@@ -137,23 +188,57 @@ public:
      * @return 找到则返回非负索引（0~numconnect-1），未找到返回-1
      */
     int findConnectIndexBySocketId(int targetSocketId) const {
-        for (int idx = 0; idx < (int)connectArray.size(); idx++) {
-            if (connectArray[idx].socketId == targetSocketId) {
-                return idx;  // 找到匹配的连接，返回索引
-            }
-        }
-        return -1;  // 未找到匹配的socketId
+        auto it = socketIndex.find(targetSocketId);
+        return it != socketIndex.end() ? it->second : -1;  // 未找到匹配的socketId返回-1
     }
 
     int findConnectIndexByIpAddress(L3Address targetIp) const {
+        auto it = ipIndex.find(targetIp);
+        return it != ipIndex.end() ? it->second : -1;  // 未找到匹配的IP地址返回-1
+    }
+
+    // ------------------------------
+    // 查找索引维护
+    // ------------------------------
+    // 根据connectArray重建socketId/IP/slaveId索引。
+    // 经getConnect()/getConnectArray()直接修改socketId、ipAddress、slaveId或从站数组后须调用；
+    // 本类的setNumConnect/addConnect/initSlavesForConnect/setConnectSocketId/clear/pack会自动调用
+    void reindex() {
+        reindexSockets();
+        ipIndex.clear();
+        slaveTables.assign(connectArray.size(), SlaveTable());
+        anySlaveIndex.fill(-1);
         for (int idx = 0; idx < (int)connectArray.size(); idx++) {
-            if (connectArray[idx].ipAddress == targetIp) {
-                return idx;  // 找到匹配的连接，返回索引
+            const connect& conn = connectArray[idx];
+            ipIndex.emplace(conn.ipAddress, idx);
+            SlaveTable& table = slaveTables[idx];
+            table.fill(-1);
+            if (conn.slaves == nullptr)
+                continue;
+            for (int slaveIdx = conn.numSlave - 1; slaveIdx >= 0; slaveIdx--)  // 逆序填表，重复slaveId保留第一个
+                table[conn.slaves[slaveIdx].slaveId] = slaveIdx;
+        }
+        for (int idx = (int)connectArray.size() - 1; idx >= 0; idx--) {
+            for (int id = 0; id < 256; id++) {
+                if (slaveTables[idx][id] >= 0)
+                    anySlaveIndex[id] = (idx << 16) | slaveTables[idx][id];
             }
         }
-        return -1;  // 未找到匹配的socketId
     }
 
+    // 只重建socketId索引（socketId在连接建立时才分配，变化比IP/从站配置频繁）
+    void reindexSockets() {
+        structureVersion++;
+        socketIndex.clear();
+        for (int idx = 0; idx < (int)connectArray.size(); idx++)
+            socketIndex.emplace(connectArray[idx].socketId, idx);
+    }
+
+    // 更新指定连接的socketId并同步索引（建立连接后调用）
+    void setConnectSocketId(int connIdx, int socketId) {
+        getConnect(connIdx).socketId = socketId;
+        reindexSockets();
+    }
 
     // ------------------------------
     // 连接管理：Setter/Getter（带合法性检查）
@@ -165,6 +250,7 @@ public:
     void setNumConnect(int newNumConnect) {
         numconnect = newNumConnect;
         connectArray.resize(numconnect);  // 调整数组长度，新增元素为默认构造的connect
+        reindex();
     }
 
     // 获取连接数组（只读，用于外部遍历/查询）
@@ -190,6 +276,7 @@ public:
     void addConnect(const connect& newConn) {
         connectArray.push_back(newConn);
         numconnect = connectArray.size();  // 同步更新连接总数
+        reindex();
     }
 
     // 初始化指定连接的从站数组（动态分配内存，避免重复初始化）
@@ -203,6 +290,384 @@ public:
         // 分配从站数组
         targetConn.numSlave = slaveCount;
         targetConn.slaves = new MSMapping[slaveCount]();  // 默认初始化（成员设为0/nullptr）
+        reindex();
+    }
+
+    // ------------------------------
+    // 紧凑存储：每个从站的四类寄存器组描述符与数据打包到一块连续内存
+    // ------------------------------
+    // 布局：[bitGroup描述符][inputBitGroup描述符][registerGroup描述符][inputRegisterGroup描述符]
+    //       [四类地址索引(uint16_t)][保持/输入寄存器数据(int16_t)][线圈/离散输入数据(uint8_t；位压缩时每组(number+7)/8字节)]
+    // 打包后各组指针与data指针指向arena内部，原有按指针访问的代码无需修改
+    static size_t alignArenaOffset(size_t offset, size_t alignment) {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // 打包单个从站（已打包则跳过），释放原来分散分配的组数组与数据数组；packCoilBits为true时线圈/离散输入按位压缩
+    static void packSlave(MSMapping& slave, bool packCoilBits = false) {
+        if (slave.arena != nullptr)
+            return;
+        // 组数组为空指针时按0组处理
+        int counts[NUM_ADDRESS_SPACES] = {
+            slave.bitGroup ? slave.numBitGroup : 0,
+            slave.inputBitGroup ? slave.numInputBitGroup : 0,
+            slave.registerGroup ? slave.numRegisterGroup : 0,
+            slave.inputRegisterGroup ? slave.numInputRegisterGroup : 0
+        };
+
+        // 1. 计算布局
+        const size_t descAlign = alignof(RegisterGroup<int16_t>);
+        size_t size = 0;
+        size_t descOffset[NUM_ADDRESS_SPACES];
+        for (int space = 0; space < NUM_ADDRESS_SPACES; space++) {
+            size = alignArenaOffset(size, descAlign);
+            descOffset[space] = size;
+            size += counts[space] * (space < HOLDING_REGISTERS ? sizeof(RegisterGroup<uint8_t>) : sizeof(RegisterGroup<int16_t>));
+        }
+        size = alignArenaOffset(size, alignof(uint16_t));
+        size_t indexOffset[NUM_ADDRESS_SPACES];
+        for (int space = 0; space < NUM_ADDRESS_SPACES; space++) {
+            indexOffset[space] = size;
+            size += counts[space] * sizeof(uint16_t);
+        }
+        size = alignArenaOffset(size, alignof(int16_t));
+        size_t registerDataOffset = size;
+        for (int i = 0; i < counts[HOLDING_REGISTERS]; i++)
+            size += slave.registerGroup[i].number * sizeof(int16_t);
+        for (int i = 0; i < counts[INPUT_REGISTERS]; i++)
+            size += slave.inputRegisterGroup[i].number * sizeof(int16_t);
+        size_t bitDataOffset = size;
+        for (int i = 0; i < counts[COILS]; i++)
+            size += bitDataSize(slave.bitGroup[i].number, packCoilBits);
+        for (int i = 0; i < counts[DISCRETE_INPUTS]; i++)
+            size += bitDataSize(slave.inputBitGroup[i].number, packCoilBits);
+
+        // 2. 分配arena并迁移描述符与数据
+        uint8_t* arena = new uint8_t[size > 0 ? size : 1]();
+        size_t bitCursor = bitDataOffset;
+        size_t registerCursor = registerDataOffset;
+        packGroups(arena, descOffset[COILS], bitCursor, slave.bitGroup, counts[COILS], packCoilBits);
+        packGroups(arena, descOffset[DISCRETE_INPUTS], bitCursor, slave.inputBitGroup, counts[DISCRETE_INPUTS], packCoilBits);
+        packGroups(arena, descOffset[HOLDING_REGISTERS], registerCursor, slave.registerGroup, counts[HOLDING_REGISTERS]);
+        packGroups(arena, descOffset[INPUT_REGISTERS], registerCursor, slave.inputRegisterGroup, counts[INPUT_REGISTERS]);
+
+        slave.numBitGroup = counts[COILS];
+        slave.numInputBitGroup = counts[DISCRETE_INPUTS];
+        slave.numRegisterGroup = counts[HOLDING_REGISTERS];
+        slave.numInputRegisterGroup = counts[INPUT_REGISTERS];
+        slave.arena = arena;
+        slave.arenaSize = size;
+
+        // 3. 建立地址索引
+        for (int space = 0; space < NUM_ADDRESS_SPACES; space++) {
+            uint16_t* index = reinterpret_cast<uint16_t*>(arena + indexOffset[space]);
+            bool sorted = space < HOLDING_REGISTERS
+                    ? buildGroupIndex(getBitGroups(slave, (AddressSpace)space), counts[space], index)
+                    : buildGroupIndex(getRegisterGroups(slave, (AddressSpace)space), counts[space], index);
+            slave.groupIndex[space] = sorted ? index : nullptr;
+        }
+    }
+
+    // 将组下标按startAddress排序写入index；组数超出uint16_t或组之间地址重叠时返回false（不建立索引）
+    template <typename ElementType>
+    static bool buildGroupIndex(const RegisterGroup<ElementType>* groups, int count, uint16_t* index) {
+        if (count > 65535)
+            return false;
+        for (int i = 0; i < count; i++)
+            index[i] = i;
+        std::sort(index, index + count, [groups](uint16_t a, uint16_t b) {
+            return groups[a].startAddress < groups[b].startAddress;
+        });
+        for (int i = 1; i < count; i++) {
+            const RegisterGroup<ElementType>& prev = groups[index[i - 1]];
+            if (uint32_t(prev.startAddress) + prev.number > groups[index[i]].startAddress)
+                return false;
+        }
+        return true;
+    }
+
+    static size_t bitDataSize(uint16_t number, bool bitPacked) {
+        return bitPacked ? (number + 7) / 8 : number;
+    }
+
+    // 将一类寄存器组的描述符复制到arena的descOffset处、数据复制到dataCursor处，并释放原数组
+    // bitPacked为true时（仅线圈/离散输入）每点一字节的原数据压缩为按位存储
+    template <typename ElementType>
+    static void packGroups(uint8_t* arena, size_t descOffset, size_t& dataCursor, RegisterGroup<ElementType>*& groups, int count, bool bitPacked = false) {
+        RegisterGroup<ElementType>* packed = reinterpret_cast<RegisterGroup<ElementType>*>(arena + descOffset);
+        for (int i = 0; i < count; i++) {
+            RegisterGroup<ElementType>* group = new (&packed[i]) RegisterGroup<ElementType>(groups[i]);
+            group->offset = dataCursor;
+            group->data = reinterpret_cast<ElementType*>(arena + dataCursor);
+            if constexpr (std::is_same<ElementType, uint8_t>::value) {
+                group->bitPacked = bitPacked;
+                if (groups[i].data != nullptr) {
+                    if (bitPacked)
+                        inet::packBits(group->data, groups[i].data, group->number);
+                    else
+                        memcpy(group->data, groups[i].data, group->number);
+                }
+                dataCursor += bitDataSize(group->number, bitPacked);
+            }
+            else {
+                if (groups[i].data != nullptr)
+                    memcpy(group->data, groups[i].data, group->number * sizeof(ElementType));
+                dataCursor += group->number * sizeof(ElementType);
+            }
+            delete[] groups[i].data;
+        }
+        delete[] groups;
+        groups = count > 0 ? packed : nullptr;
+    }
+
+    // 设置pack()时线圈/离散输入是否按位压缩（须在pack()之前调用，对已打包的从站不生效）
+    void setBitPackedCoils(bool enabled) { bitPackedCoils = enabled; }
+    bool getBitPackedCoils() const { return bitPackedCoils; }
+
+    // 打包所有连接下的所有从站（加载配置或反序列化之后调用）
+    void pack() {
+        for (auto& conn : connectArray) {
+            if (conn.slaves == nullptr)
+                continue;
+            for (int slaveIdx = 0; slaveIdx < conn.numSlave; slaveIdx++)
+                packSlave(conn.slaves[slaveIdx], bitPackedCoils);
+        }
+        reindex();
+    }
+
+    // ------------------------------
+    // 访问接口：按地址空间访问寄存器组与单点数据（屏蔽具体存储布局，供各App逐步迁移）
+    // ------------------------------
+    static int getNumGroups(const MSMapping& slave, AddressSpace space) {
+        switch (space) {
+            case COILS: return slave.numBitGroup;
+            case DISCRETE_INPUTS: return slave.numInputBitGroup;
+            case HOLDING_REGISTERS: return slave.numRegisterGroup;
+            case INPUT_REGISTERS: return slave.numInputRegisterGroup;
+            default: throw cRuntimeError("Invalid address space %d", (int)space);
+        }
+    }
+
+    static RegisterGroup<uint8_t>* getBitGroups(const MSMapping& slave, AddressSpace space) {
+        if (space == COILS) return slave.bitGroup;
+        if (space == DISCRETE_INPUTS) return slave.inputBitGroup;
+        throw cRuntimeError("Address space %d does not hold bit groups", (int)space);
+    }
+
+    static RegisterGroup<int16_t>* getRegisterGroups(const MSMapping& slave, AddressSpace space) {
+        if (space == HOLDING_REGISTERS) return slave.registerGroup;
+        if (space == INPUT_REGISTERS) return slave.inputRegisterGroup;
+        throw cRuntimeError("Address space %d does not hold register groups", (int)space);
+    }
+
+    // 在指定连接下按slaveId查找从站（直接查表），未找到返回nullptr
+    MSMapping* findSlave(int connIdx, uint8_t slaveId) {
+        if (connIdx < 0 || connIdx >= (int)slaveTables.size())
+            return nullptr;
+        int slaveIdx = slaveTables[connIdx][slaveId];
+        return slaveIdx >= 0 ? &connectArray[connIdx].slaves[slaveIdx] : nullptr;
+    }
+
+    // 在所有连接中按slaveId查找第一个匹配的从站（直接查表），未找到返回nullptr；connIdx非空时返回所属连接下标
+    MSMapping* findSlave(uint8_t slaveId, int* connIdx = nullptr) {
+        int32_t entry = anySlaveIndex[slaveId];
+        if (connIdx)
+            *connIdx = entry >= 0 ? entry >> 16 : -1;
+        return entry >= 0 ? &connectArray[entry >> 16].slaves[entry & 0xFFFF] : nullptr;
+    }
+
+    // ------------------------------
+    // 位数据访问：屏蔽每点一字节与位压缩两种存储方式
+    // ------------------------------
+    // 读取组内第index个点（位压缩时为0/1，否则为存储的原值）
+    static uint8_t getBit(const RegisterGroup<uint8_t>& group, uint32_t index) {
+        if (group.bitPacked)
+            return (group.data[index / 8] >> (index % 8)) & 0x01;
+        return group.data[index];
+    }
+
+    // 写入组内第index个点
+    static void setBit(RegisterGroup<uint8_t>& group, uint32_t index, uint8_t value) {
+        if (group.bitPacked) {
+            uint8_t mask = 1u << (index % 8);
+            group.data[index / 8] = value ? (group.data[index / 8] | mask) : (group.data[index / 8] & ~mask);
+        }
+        else
+            group.data[index] = value ? 1 : 0;
+    }
+
+    // 将组内[index, index+count)按Modbus报文布局（低位在前）写入dst，共(count+7)/8字节，末字节高位补0
+    static void readBits(const RegisterGroup<uint8_t>& group, uint32_t index, uint32_t count, uint8_t* dst) {
+        if (group.bitPacked) {
+            if (count % 8)
+                dst[count / 8] = 0;
+            copyBits(dst, 0, group.data, index, count);
+        }
+        else
+            packBits(dst, group.data + index, count);
+    }
+
+    // 将src中从第srcBitOffset位开始的count个点（Modbus报文布局）写入组内[index, index+count)
+    static void writeBits(RegisterGroup<uint8_t>& group, uint32_t index, const uint8_t* src, uint32_t srcBitOffset, uint32_t count) {
+        if (group.bitPacked)
+            copyBits(group.data, index, src, srcBitOffset, count);
+        else
+            unpackBits(group.data + index, src, srcBitOffset, count);
+    }
+
+    // 将src中count个大端寄存器写入组内[index, index+count)，返回数值是否有变化
+    static bool storeRegisters(RegisterGroup<int16_t>& group, uint32_t index, const uint8_t* src, uint32_t count) {
+        bool changed = false;
+        int16_t decoded[128];
+        for (uint32_t done = 0; done < count; ) {
+            uint32_t n = std::min<uint32_t>(count - done, 128);
+            decodeRegisters(decoded, src + 2 * done, n);
+            int16_t* dst = group.data + index + done;
+            if (memcmp(dst, decoded, n * sizeof(int16_t)) != 0) {
+                memcpy(dst, decoded, n * sizeof(int16_t));
+                changed = true;
+            }
+            done += n;
+        }
+        return changed;
+    }
+
+    // 将src中从第srcBitOffset位开始的count个点写入组内[index, index+count)，返回数值是否有变化
+    static bool storeBits(RegisterGroup<uint8_t>& group, uint32_t index, const uint8_t* src, uint32_t srcBitOffset, uint32_t count) {
+        bool changed = false;
+        uint8_t current[256], incoming[256];
+        for (uint32_t done = 0; done < count; ) {
+            uint32_t n = std::min<uint32_t>(count - done, 8 * sizeof(current));
+            size_t bytes = (n + 7) / 8;
+            readBits(group, index + done, n, current);
+            memset(incoming, 0, bytes);
+            copyBits(incoming, 0, src, srcBitOffset + done, n);
+            if (memcmp(current, incoming, bytes) != 0) {
+                writeBits(group, index + done, incoming, 0, n);
+                changed = true;
+            }
+            done += n;
+        }
+        return changed;
+    }
+
+    // ------------------------------
+    // 变更版本：数据变化时组版本取递增后的generation，并逐级记到所属从站和连接上；
+    // 读取方保存上次看到的generation，之后只需进入版本更大的连接/从站/组
+    // ------------------------------
+    uint64_t getGeneration() const { return generation; }
+
+    // 结构版本：与generation一起唯一确定序列化结果（socketId等不属于寄存器数据的字段变化时只递增该版本）
+    uint64_t getStructureVersion() const { return structureVersion; }
+
+    // 快照副本是否可以用getGeneration()作为lastSeenVersion请求增量（否则应请求全量）
+    bool hasSnapshotBase() const { return snapshotBase; }
+
+    // 记录一次对寄存器组的刷新（changed为true时分配新版本）；connIdx未知时传-1
+    template <typename ElementType>
+    void touchGroup(int connIdx, MSMapping& slave, RegisterGroup<ElementType>& group, bool changed, simtime_t now) {
+        group.lastUpdate = now;
+        if (!changed)
+            return;
+        group.version = slave.version = ++generation;
+        if (connIdx < 0 || connIdx >= (int)connectArray.size()) {
+            for (connIdx = 0; connIdx < (int)connectArray.size(); connIdx++) {
+                const connect& conn = connectArray[connIdx];
+                if (&slave >= conn.slaves && &slave < conn.slaves + conn.numSlave)
+                    break;
+            }
+        }
+        if (connIdx < (int)connectArray.size())
+            connectArray[connIdx].version = generation;
+    }
+
+    // 按连接、从站、地址空间顺序遍历版本大于sinceVersion的寄存器组，对每个组调用fn(connIdx, slave, space, groupIdx)
+    template <typename Fn>
+    void forEachChangedGroup(uint64_t sinceVersion, Fn fn) const {
+        for (int connIdx = 0; connIdx < (int)connectArray.size(); connIdx++) {
+            const connect& conn = connectArray[connIdx];
+            if (conn.version <= sinceVersion || conn.slaves == nullptr)
+                continue;
+            for (int slaveIdx = 0; slaveIdx < conn.numSlave; slaveIdx++) {
+                const MSMapping& slave = conn.slaves[slaveIdx];
+                if (slave.version <= sinceVersion)
+                    continue;
+                for (int space = 0; space < NUM_ADDRESS_SPACES; space++) {
+                    int numGroups = getNumGroups(slave, (AddressSpace)space);
+                    for (int g = 0; g < numGroups; g++) {
+                        uint64_t version = space < HOLDING_REGISTERS ? getBitGroups(slave, (AddressSpace)space)[g].version
+                                                                      : getRegisterGroups(slave, (AddressSpace)space)[g].version;
+                        if (version > sinceVersion)
+                            fn(connIdx, slave, (AddressSpace)space, g);
+                    }
+                }
+            }
+        }
+    }
+
+    // 查找完整包含[address, address+quantity)的寄存器组，未找到返回nullptr
+    // 有地址索引时二分查找O(log n)，否则线性查找
+    template <typename ElementType>
+    static RegisterGroup<ElementType>* findGroup(const MSMapping& slave, AddressSpace space, uint16_t address, uint16_t quantity = 1) {
+        RegisterGroup<ElementType>* groups = getGroups<ElementType>(slave, space);
+        int numGroups = getNumGroups(slave, space);
+        uint32_t end = uint32_t(address) + quantity;
+        const uint16_t* index = slave.groupIndex[space];
+        if (groups == nullptr)
+            return nullptr;
+        if (index != nullptr) {
+            // 最后一个startAddress <= address的组
+            const uint16_t* pos = std::upper_bound(index, index + numGroups, address, [groups](uint16_t addr, uint16_t i) {
+                return addr < groups[i].startAddress;
+            });
+            if (pos == index)
+                return nullptr;
+            RegisterGroup<ElementType>* group = &groups[*(pos - 1)];
+            return end <= uint32_t(group->startAddress) + group->number ? group : nullptr;
+        }
+        for (int i = 0; i < numGroups; i++) {
+            if (address >= groups[i].startAddress && end <= uint32_t(groups[i].startAddress) + groups[i].number)
+                return &groups[i];
+        }
+        return nullptr;
+    }
+
+    // 按地址升序遍历与[start, start+quantity)有交集的寄存器组，对每个组调用fn(group)，返回访问的组数
+    // 有地址索引时先二分定位首个相交组，只访问相交的组
+    template <typename ElementType, typename Fn>
+    static int forEachGroupInRange(const MSMapping& slave, AddressSpace space, uint16_t start, uint16_t quantity, Fn fn) {
+        RegisterGroup<ElementType>* groups = getGroups<ElementType>(slave, space);
+        int numGroups = getNumGroups(slave, space);
+        uint32_t end = uint32_t(start) + quantity;
+        const uint16_t* index = slave.groupIndex[space];
+        int visited = 0;
+        if (groups == nullptr)
+            return 0;
+        if (index != nullptr) {
+            // 组互不重叠且按起始地址排序，结束地址同样有序：定位首个结束地址 > start 的组
+            const uint16_t* pos = std::upper_bound(index, index + numGroups, start, [groups](uint16_t addr, uint16_t i) {
+                return addr < uint32_t(groups[i].startAddress) + groups[i].number;
+            });
+            for (; pos != index + numGroups && groups[*pos].startAddress < end; ++pos, ++visited)
+                fn(groups[*pos]);
+            return visited;
+        }
+        for (int i = 0; i < numGroups; i++) {
+            if (groups[i].startAddress < end && uint32_t(groups[i].startAddress) + groups[i].number > start) {
+                fn(groups[i]);
+                visited++;
+            }
+        }
+        return visited;
+    }
+
+    // 按元素类型取组数组：uint8_t对应线圈/离散输入，int16_t对应保持/输入寄存器
+    template <typename ElementType>
+    static RegisterGroup<ElementType>* getGroups(const MSMapping& slave, AddressSpace space) {
+        if constexpr (std::is_same<ElementType, uint8_t>::value)
+            return getBitGroups(slave, space);
+        else
+            return getRegisterGroups(slave, space);
     }
 
     // 从缓冲区读取uint16_t（网络字节序→主机字节序）
@@ -231,6 +696,13 @@ public:
         return ntohl(netValue); // 转换为主机字节序
     }
 
+    // 从缓冲区读取uint64_t（网络字节序，高32位在前）
+    uint64_t deserializeUint64(const std::vector<uint8_t>& buffer, size_t& offset) {
+        uint64_t high = (uint32_t)deserializeInt(buffer, offset);
+        uint64_t low = (uint32_t)deserializeInt(buffer, offset);
+        return high << 32 | low;
+    }
+
     // 从缓冲区读取L3Address（支持IPv4/IPv6）
     L3Address deserializeL3Address(const std::vector<uint8_t>& buffer, size_t& offset) {
         if (offset + 1 > buffer.size()) {
@@ -384,6 +856,9 @@ public:
         if (offset != buffer.size()) {
             EV_WARN << "deserializeModbusStorage: Extra bytes in buffer (read " << offset << ", total " << buffer.size() << ")" << endl;
         }
+
+        // 打包为紧凑存储
+        storage->pack();
     }
 
     // 将uint16_t转换为网络字节序（大端）并写入缓冲区
@@ -400,6 +875,12 @@ public:
                      reinterpret_cast<uint8_t*>(&netValue) + sizeof(netValue));
     }
 
+    // 将uint64_t按网络字节序（高32位在前）写入缓冲区
+    void serializeUint64(uint64_t value, std::vector<uint8_t>& buffer) {
+        serializeInt((int)(uint32_t)(value >> 32), buffer);
+        serializeInt((int)(uint32_t)value, buffer);
+    }
+
     void serializeL3Address(const L3Address& addr, std::vector<uint8_t>& buffer) {
         switch (addr.getType()) {
             case L3Address::IPv4: {
@@ -443,7 +924,7 @@ public:
         serializeUint16(group.number, buffer); // 再次确认数组长度（冗余校验）
         for (uint16_t i = 0; i < group.number; i++) {
             if constexpr (std::is_same_v<ElementType, uint8_t>) {
-                buffer.push_back(group.data[i]); // uint8_t直接写入1字节
+                buffer.push_back(getBit(group, i)); // 每点写入1字节（与存储是否位压缩无关）
             }
             else if constexpr (std::is_same_v<ElementType, int16_t>) {
                 int16_t netValue = htons(group.data[i]); // 转换为网络序
@@ -553,7 +1034,14 @@ public:
         std::vector<uint8_t> body(buffer.begin() + sizeof(int), buffer.begin() + sizeof(int) + totalLen);
         // 反序列化（捕获缓冲区下溢异常，避免中断仿真）
         try {
-            deserializeModbusStorage(storage, body);
+            // 带版本的快照帧以SNAPSHOT_FRAME_MAGIC开头，旧格式以非负的连接总数开头
+            size_t offset = 0;
+            if (body.size() >= sizeof(int) && deserializeInt(body, offset) == SNAPSHOT_FRAME_MAGIC)
+                applySnapshotFrame(storage, body, offset);
+            else {
+                deserializeModbusStorage(storage, body);
+                storage->snapshotBase = false;  // 旧格式不带版本，无法作为增量基准
+            }
         }
         catch (const cRuntimeError &e) {
             EV_ERROR << "tryDeserializeModbusStorage: deserialization failed: " << e.what() << endl;
@@ -563,6 +1051,152 @@ public:
         return true;
     }
 
+    // ------------------------------
+    // 带版本的快照帧（运维侧增量拉取）
+    // 帧体：int MAGIC(-1) | uint8 类型(0全量/1增量) | uint64 基准版本 | uint64 当前generation | 内容
+    //   全量：与serializeModbusStorage相同的连接/从站/寄存器组数据
+    //   增量：uint32 记录数，每条记录对应一个版本大于基准的寄存器组：
+    //         int connIdx | uint8 slaveId | uint8 地址空间 | uint16 组下标 | uint16 startAddress | uint16 number
+    //         | uint64 组版本 | 数据（寄存器为number个大端int16；位数据按Modbus报文布局压缩为(number+7)/8字节）
+    // ------------------------------
+    static constexpr int SNAPSHOT_FRAME_MAGIC = -1;
+    enum SnapshotFrameKind : uint8_t { SNAPSHOT_FULL = 0, SNAPSHOT_DELTA = 1 };
+
+    // 生成带长度前缀的快照帧：delta为true时只包含版本大于sinceVersion的寄存器组
+    std::vector<uint8_t> serializeSnapshotWithLength(ModbusStorage* storage, bool delta, uint64_t sinceVersion) {
+        return serializeSnapshotWithLength(storage, delta, sinceVersion,
+                [](int, const MSMapping&, AddressSpace, uint16_t, uint16_t) { return true; });
+    }
+
+    // 同上，增量帧只包含filter(connIdx, slave, space, startAddress, number)返回true的寄存器组；
+    // numRecords非空时返回写入的记录数
+    template <typename Filter>
+    std::vector<uint8_t> serializeSnapshotWithLength(ModbusStorage* storage, bool delta, uint64_t sinceVersion, Filter filter, uint32_t* numRecordsOut = nullptr) {
+        std::vector<uint8_t> buffer(sizeof(int));  // 预留长度前缀
+        serializeInt(SNAPSHOT_FRAME_MAGIC, buffer);
+        buffer.push_back(delta ? SNAPSHOT_DELTA : SNAPSHOT_FULL);
+        serializeUint64(delta ? sinceVersion : 0, buffer);
+        serializeUint64(storage->generation, buffer);
+        if (!delta) {
+            std::vector<uint8_t> body = serializeModbusStorage(storage);
+            buffer.insert(buffer.end(), body.begin(), body.end());
+        }
+        else {
+            size_t countOffset = buffer.size();
+            serializeInt(0, buffer);
+            uint32_t numRecords = 0;
+            storage->forEachChangedGroup(sinceVersion, [&](int connIdx, const MSMapping& slave, AddressSpace space, int groupIdx) {
+                uint16_t startAddress = space < HOLDING_REGISTERS ? getBitGroups(slave, space)[groupIdx].startAddress
+                                                                  : getRegisterGroups(slave, space)[groupIdx].startAddress;
+                uint16_t number = space < HOLDING_REGISTERS ? getBitGroups(slave, space)[groupIdx].number
+                                                            : getRegisterGroups(slave, space)[groupIdx].number;
+                if (!filter(connIdx, slave, space, startAddress, number))
+                    return;
+                serializeInt(connIdx, buffer);
+                buffer.push_back(slave.slaveId);
+                buffer.push_back(space);
+                serializeUint16(groupIdx, buffer);
+                if (space < HOLDING_REGISTERS) {
+                    const RegisterGroup<uint8_t>& group = getBitGroups(slave, space)[groupIdx];
+                    serializeUint16(group.startAddress, buffer);
+                    serializeUint16(group.number, buffer);
+                    serializeUint64(group.version, buffer);
+                    size_t dataOffset = buffer.size();
+                    buffer.resize(dataOffset + (group.number + 7) / 8);
+                    readBits(group, 0, group.number, buffer.data() + dataOffset);
+                }
+                else {
+                    const RegisterGroup<int16_t>& group = getRegisterGroups(slave, space)[groupIdx];
+                    serializeUint16(group.startAddress, buffer);
+                    serializeUint16(group.number, buffer);
+                    serializeUint64(group.version, buffer);
+                    size_t dataOffset = buffer.size();
+                    buffer.resize(dataOffset + 2 * group.number);
+                    encodeRegisters(buffer.data() + dataOffset, group.data, group.number);
+                }
+                numRecords++;
+            });
+            uint32_t netCount = htonl(numRecords);
+            memcpy(&buffer[countOffset], &netCount, sizeof(netCount));
+            if (numRecordsOut)
+                *numRecordsOut = numRecords;
+        }
+        uint32_t netLen = htonl(buffer.size() - sizeof(int));
+        memcpy(buffer.data(), &netLen, sizeof(netLen));
+        return buffer;
+    }
+
+    // 应用快照帧体（offset位于MAGIC之后）。增量帧的基准版本超出本地已有版本（中间有遗漏），
+    // 或记录与本地结构不符时丢弃该帧并清除增量基准，下次请求全量快照
+    void applySnapshotFrame(ModbusStorage* storage, const std::vector<uint8_t>& body, size_t& offset) {
+        if (offset + 1 > body.size())
+            throw cRuntimeError("applySnapshotFrame: Buffer underflow (kind)");
+        uint8_t kind = body[offset++];
+        uint64_t baseVersion = deserializeUint64(body, offset);
+        uint64_t frameGeneration = deserializeUint64(body, offset);
+
+        if (kind == SNAPSHOT_FULL) {
+            std::vector<uint8_t> rest(body.begin() + offset, body.end());
+            deserializeModbusStorage(storage, rest);
+            storage->generation = frameGeneration;
+            storage->snapshotBase = true;
+            return;
+        }
+        if (kind != SNAPSHOT_DELTA)
+            throw cRuntimeError("applySnapshotFrame: Unknown frame kind %u", kind);
+
+        if (!storage->snapshotBase || baseVersion > storage->generation) {
+            EV_WARN << "applySnapshotFrame: 增量基准版本" << baseVersion << "超出本地版本" << storage->generation
+                    << "，丢弃并改为请求全量快照" << endl;
+            storage->snapshotBase = false;
+            return;
+        }
+        uint32_t numRecords = (uint32_t)deserializeInt(body, offset);
+        for (uint32_t r = 0; r < numRecords; r++) {
+            int connIdx = deserializeInt(body, offset);
+            if (offset + 2 > body.size())
+                throw cRuntimeError("applySnapshotFrame: Buffer underflow (record header)");
+            uint8_t slaveId = body[offset++];
+            uint8_t space = body[offset++];
+            uint16_t groupIdx = deserializeUint16(body, offset);
+            uint16_t startAddress = deserializeUint16(body, offset);
+            uint16_t number = deserializeUint16(body, offset);
+            uint64_t version = deserializeUint64(body, offset);
+            size_t dataSize = space < HOLDING_REGISTERS ? (number + 7) / 8 : 2 * (size_t)number;
+            if (space >= NUM_ADDRESS_SPACES || offset + dataSize > body.size())
+                throw cRuntimeError("applySnapshotFrame: Malformed record %u", r);
+
+            MSMapping* slave = storage->findSlave(connIdx, slaveId);
+            bool matches = slave != nullptr && groupIdx < getNumGroups(*slave, (AddressSpace)space);
+            if (matches && space < HOLDING_REGISTERS) {
+                RegisterGroup<uint8_t>& group = getBitGroups(*slave, (AddressSpace)space)[groupIdx];
+                matches = group.startAddress == startAddress && group.number == number;
+                if (matches && version > group.version) {  // 乱序到达的旧记录不覆盖新数据
+                    writeBits(group, 0, &body[offset], 0, number);
+                    group.version = version;
+                    slave->version = std::max(slave->version, version);
+                }
+            }
+            else if (matches) {
+                RegisterGroup<int16_t>& group = getRegisterGroups(*slave, (AddressSpace)space)[groupIdx];
+                matches = group.startAddress == startAddress && group.number == number;
+                if (matches && version > group.version) {
+                    decodeRegisters(group.data, &body[offset], number);
+                    group.version = version;
+                    slave->version = std::max(slave->version, version);
+                }
+            }
+            if (!matches) {
+                EV_WARN << "applySnapshotFrame: 增量记录与本地结构不符（连接" << connIdx << "，从站" << (int)slaveId
+                        << "，组" << groupIdx << "），改为请求全量快照" << endl;
+                storage->snapshotBase = false;
+                return;
+            }
+            offset += dataSize;
+        }
+        storage->generation = std::max(storage->generation, frameGeneration);
+    }
+
     /**
      * 将ModbusStorage数据保存为JSON文件，格式与ModbusStorageConfig.json一致
      * @param filePath 保存路径
@@ -599,7 +1233,7 @@ public:
                     groupJson["number"] = group.number;
                     groupJson["data"] = ordered_json::array();  // 数据数组
                     for (uint16_t dataIdx = 0; dataIdx < group.number; ++dataIdx) {
-                        groupJson["data"].push_back(group.data[dataIdx]);
+                        groupJson["data"].push_back(getBit(group, dataIdx));
                     }
                     bitGroupsJson.push_back(groupJson);
                 }
@@ -614,7 +1248,7 @@ public:
                     groupJson["number"] = group.number;
                     groupJson["data"] = ordered_json::array();
                     for (uint16_t dataIdx = 0; dataIdx < group.number; ++dataIdx) {
-                        groupJson["data"].push_back(group.data[dataIdx]);
+                        groupJson["data"].push_back(getBit(group, dataIdx));
                     }
                     inputBitGroupsJson.push_back(groupJson);
                 }
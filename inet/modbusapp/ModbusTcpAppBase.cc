@@ -32,6 +32,7 @@ void ModbusTcpAppBase::initialize(int stage)
         configFileName = par("configFile");
         int numConnect = par("numConnect");
         modbusStorage.setNumConnect(numConnect);
+        modbusStorage.setBitPackedCoils(par("packedCoils"));
     }
     else if (stage == INITSTAGE_APPLICATION_LAYER) {
         // 解析配置文件
@@ -81,6 +82,7 @@ void ModbusTcpAppBase::parseConfigFile()
             slave.numInputBitGroup = jsonSlave["numInputBitGroup"];
             slave.numRegisterGroup = jsonSlave["numRegisterGroup"];
             slave.numInputRegisterGroup = jsonSlave["numInputRegisterGroup"];
+            slave.scanInterval = jsonSlave.value("scanInterval", 0.0);
 
             // 加载线圈组
             loadRegisterGroups<uint8_t>(jsonSlave["bitGroup"], slave.bitGroup, slave.numBitGroup);
@@ -96,6 +98,9 @@ void ModbusTcpAppBase::parseConfigFile()
 
         connectIndex++;
     }
+
+    // 打包为紧凑存储
+    modbusStorage.pack();
 }
 
 template <typename ElementType>
@@ -111,6 +116,7 @@ void ModbusTcpAppBase::loadRegisterGroups(const json& jsonGroups, RegisterGroup<
             groups[groupIndex].startAddress = jsonGroup["startAddress"];
             groups[groupIndex].number = jsonGroup["number"];
             groups[groupIndex].data = new ElementType[groups[groupIndex].number];
+            groups[groupIndex].scanInterval = jsonGroup.value("scanInterval", 0.0);
 
             int dataIndex = 0;
             for (const auto& value : jsonGroup["data"]) {
@@ -188,8 +194,7 @@ void ModbusTcpAppBase::connectAll()
 
         // 设置ModbusStorage中的socketId和ipAddress
         if (i < modbusStorage.getNumConnect()) {
-            auto& connect = modbusStorage.getConnect(i);
-            connect.socketId = socket->getSocketId();
+            modbusStorage.setConnectSocketId(i, socket->getSocketId());
         }
     }
 }
@@ -244,7 +249,7 @@ TcpSocket* ModbusTcpAppBase::connectTo(const L3Address& address)
     emit(connectSignal, 1L);
 
     int index = modbusStorage.findConnectIndexByIpAddress(address);
-    modbusStorage.getConnect(index).socketId = socket->getSocketId();
+    modbusStorage.setConnectSocketId(index, socket->getSocketId());
 
 
     return socket;
@@ -277,12 +282,6 @@ void ModbusTcpAppBase::sendPacket(Packet *pkt, TcpSocket *socket)
     // 关键：获取消息所有权（若消息来自TransitApp，其所有者可能是TransitApp）
     take(pkt); // 将消息所有者重新绑定为当前模块（ModbusMasterApp）
 
-
-
-    auto chunk = pkt->peekDataAt(B(0), pkt->getTotalLength());
-    waitProcessPacketSocketQueue[socket->getSocketId()].push(chunk);
-
-
     EV_INFO << "发送pkt，ID=" << pkt->getId() << endl;
     int numBytes = pkt->getByteLength();
     emit(packetSentSignal, pkt);
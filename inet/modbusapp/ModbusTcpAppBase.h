@@ -36,8 +36,6 @@ class INET_API ModbusTcpAppBase : public ApplicationBase, public TcpSocket::ICal
     int bytesSent = 0;
     int bytesRcvd = 0;
 
-    std::map<int, ChunkQueue> waitProcessPacketSocketQueue;
-
     // statistics:
     static simsignal_t connectSignal;
 
@@ -26,21 +26,37 @@ namespace inet {
 
 Define_Module(ModbusTcpServerApp);
 
+simsignal_t ModbusTcpServerApp::storageChangedSignal = registerSignal("storageChanged");
+
+ModbusTcpServerApp::~ModbusTcpServerApp()
+{
+    for (auto& entry : subscriptions)
+        cancelAndDelete(entry.second.pushTimer);
+}
+
 void ModbusTcpServerApp::initialize(int stage)
 {
     cSimpleModule::initialize(stage);
 
     if (stage == INITSTAGE_LOCAL) {
         delay = par("replyDelay");
+        minPushInterval = par("minPushInterval");
         maxMsgDelay = 0;
 
         // statistics
         msgsRcvd = msgsSent = bytesRcvd = bytesSent = 0;
+        numFullSnapshots = numDeltaSnapshots = numPushes = 0;
+        snapshotCacheHits = snapshotCacheMisses = 0;
 
         WATCH(msgsRcvd);
         WATCH(msgsSent);
         WATCH(bytesRcvd);
         WATCH(bytesSent);
+        WATCH(numFullSnapshots);
+        WATCH(numDeltaSnapshots);
+        WATCH(numPushes);
+        WATCH(snapshotCacheHits);
+        WATCH(snapshotCacheMisses);
     }
     else if (stage == INITSTAGE_APPLICATION_LAYER) {
         const char *localAddress = par("localAddress");
@@ -49,6 +65,10 @@ void ModbusTcpServerApp::initialize(int stage)
         socket.bind(localAddress[0] ? L3AddressResolver().resolve(localAddress) : L3Address(), localPort);
         socket.listen();
 
+        // 订阅主站的存储变化通知，用于向订阅的运维站推送
+        if (auto modbusMasterApp = dynamic_cast<ModbusMasterApp *>(findModuleByPath("^.app[0]")))
+            modbusMasterApp->subscribe(storageChangedSignal, this);
+
         cModule *node = findContainingNode(this);
         NodeStatus *nodeStatus = node ? check_and_cast_nullable<NodeStatus *>(node->getSubmodule("status")) : nullptr;
         bool isOperational = (!nodeStatus) || nodeStatus->getState() == NodeStatus::UP;
@@ -87,19 +107,177 @@ void ModbusTcpServerApp::sendBack(cMessage *msg)
     send(msg, "socketOut");
 }
 
+// 将序列化结果封装为不可变chunk，打上生成时刻（缓存复用时即为快照生成时刻）
+Ptr<const BytesChunk> ModbusTcpServerApp::createStorageChunk(std::vector<uint8_t>&& bytes)
+{
+    auto payload = makeShared<BytesChunk>();
+    payload->setBytes(std::move(bytes));
+    payload->addTag<CreationTimeTag>()->setCreationTime(simTime());
+    payload->markImmutable();
+    return payload;
+}
+
+Packet *ModbusTcpServerApp::createStoragePacket(const char *name, int connId, const Ptr<const BytesChunk>& payload)
+{
+    Packet *outPacket = new Packet(name, TCP_C_SEND);
+    outPacket->addTag<SocketReq>()->setSocketId(connId);
+    // Tag the Packet as well (the chunk is tagged in createStorageChunk) for robust dataAge recording
+    outPacket->insertAtBack(payload);
+    outPacket->addTag<CreationTimeTag>()->setCreationTime(simTime());
+    return outPacket;
+}
+
+Ptr<const BytesChunk> ModbusTcpServerApp::getSnapshotChunk(SnapshotCacheKind kind, ModbusStorage *modbusStorage, uint64_t sinceVersion)
+{
+    SnapshotCache& cache = snapshotCache[kind];
+    if (cache.chunk != nullptr && cache.generation == modbusStorage->getGeneration()
+            && cache.structureVersion == modbusStorage->getStructureVersion() && cache.sinceVersion == sinceVersion) {
+        snapshotCacheHits++;
+        return cache.chunk;
+    }
+    snapshotCacheMisses++;
+    std::vector<uint8_t> bytes;
+    if (kind == CACHE_LEGACY)
+        bytes = modbusStorage->serializeModbusStorageWithLength(modbusStorage);
+    else
+        bytes = modbusStorage->serializeSnapshotWithLength(modbusStorage, kind == CACHE_DELTA, sinceVersion);
+    cache.chunk = createStorageChunk(std::move(bytes));
+    cache.generation = modbusStorage->getGeneration();
+    cache.structureVersion = modbusStorage->getStructureVersion();
+    cache.sinceVersion = sinceVersion;
+    return cache.chunk;
+}
+
+// 解析订阅范围：以空格/逗号/分号分隔的若干项，每项为"*"（全部）或
+// "slaveId[:co|di|hr|ir[:start[-end]]]"（地址为十进制闭区间）；无法解析的项忽略
+std::vector<ModbusTcpServerApp::SubscriptionRange> ModbusTcpServerApp::parseSubscription(const char *spec) const
+{
+    static const char *spaceNames[NUM_ADDRESS_SPACES] = { "co", "di", "hr", "ir" };
+    std::vector<SubscriptionRange> ranges;
+    cStringTokenizer tokenizer(spec, " ,;\t");
+    while (tokenizer.hasMoreTokens()) {
+        std::string item = tokenizer.nextToken();
+        SubscriptionRange range;
+        if (item != "*") {
+            std::vector<std::string> fields = cStringTokenizer(item.c_str(), ":").asVector();
+            try {
+                range.slaveId = std::stoi(fields.at(0));
+                if (fields.size() > 1) {
+                    range.space = std::find(spaceNames, spaceNames + NUM_ADDRESS_SPACES, fields[1]) - spaceNames;
+                    if (range.space == NUM_ADDRESS_SPACES)
+                        throw std::invalid_argument(fields[1]);
+                }
+                if (fields.size() > 2) {
+                    size_t dash = fields[2].find('-');
+                    range.start = std::stoi(fields[2].substr(0, dash));
+                    range.end = dash == std::string::npos ? range.start : std::stoi(fields[2].substr(dash + 1));
+                }
+                if (fields.size() > 3 || range.slaveId < 0 || range.slaveId > 255 || range.start > range.end)
+                    throw std::invalid_argument(item);
+            }
+            catch (const std::exception&) {
+                EV_WARN << "忽略无法解析的订阅项: " << item << endl;
+                continue;
+            }
+        }
+        ranges.push_back(range);
+    }
+    return ranges;
+}
+
+bool ModbusTcpServerApp::matchesSubscription(const Subscription& sub, const MSMapping& slave, AddressSpace space, uint16_t startAddress, uint16_t number) const
+{
+    if (number == 0)
+        return false;
+    for (const auto& range : sub.ranges) {
+        if ((range.slaveId < 0 || range.slaveId == slave.slaveId) && (range.space < 0 || range.space == space)
+                && startAddress <= range.end && startAddress + number - 1 >= range.start)
+            return true;
+    }
+    return false;
+}
+
+void ModbusTcpServerApp::subscribe(int connId, const char *spec, uint64_t generation)
+{
+    Subscription& sub = subscriptions[connId];
+    if (!sub.pushTimer) {
+        sub.connId = connId;
+        sub.pushTimer = new cMessage("pushTimer");
+        sub.pushTimer->setContextPointer(&sub);
+    }
+    sub.ranges = parseSubscription(spec);
+    sub.lastSeenVersion = generation;  // 随订阅回复的全量快照即为推送基准
+    sub.lastPush = simTime();
+    EV_INFO << "socketId=" << connId << "订阅\"" << spec << "\"，共" << sub.ranges.size() << "项" << endl;
+}
+
+void ModbusTcpServerApp::unsubscribe(int connId)
+{
+    auto it = subscriptions.find(connId);
+    if (it == subscriptions.end())
+        return;
+    cancelAndDelete(it->second.pushTimer);
+    subscriptions.erase(it);
+}
+
+// 推送自上次推送以来订阅范围内变化的寄存器组；范围外的变化不推送，也不推进lastSeenVersion，
+// 以保证每个推送帧的基准版本与运维站副本的版本一致
+void ModbusTcpServerApp::pushChanges(Subscription& sub)
+{
+    ModbusMasterApp *modbusMasterApp = check_and_cast<ModbusMasterApp*>(findModuleByPath("^.app[0]"));
+    ModbusStorage *modbusStorage = &modbusMasterApp->getModbusStorage();
+    uint32_t numRecords = 0;
+    std::vector<uint8_t> bytes = modbusStorage->serializeSnapshotWithLength(modbusStorage, true, sub.lastSeenVersion,
+            [&](int, const MSMapping& slave, AddressSpace space, uint16_t startAddress, uint16_t number) {
+                return matchesSubscription(sub, slave, space, startAddress, number);
+            }, &numRecords);
+    if (numRecords == 0)
+        return;
+
+    sub.lastSeenVersion = modbusStorage->getGeneration();
+    sub.lastPush = simTime();
+    numPushes++;
+    EV_INFO << "向socketId=" << sub.connId << "推送" << numRecords << "个变化的寄存器组，版本" << sub.lastSeenVersion << endl;
+    sendOrSchedule(createStoragePacket("ModbusStoragePush", sub.connId, createStorageChunk(std::move(bytes))), delay);
+}
+
+// 主站存储变化：每个订阅者在距上次推送minPushInterval后推送一次，期间的变化合并到同一次推送
+void ModbusTcpServerApp::receiveSignal(cComponent *source, simsignal_t signalID, intval_t value, cObject *details)
+{
+    Enter_Method_Silent();
+    for (auto& entry : subscriptions) {
+        Subscription& sub = entry.second;
+        if (!sub.pushTimer->isScheduled())
+            scheduleAt(std::max(simTime(), sub.lastPush + minPushInterval), sub.pushTimer);
+    }
+}
+
 void ModbusTcpServerApp::handleMessage(cMessage *msg)
 {
     if (msg->isSelfMessage()) {
-        sendBack(msg);
+        if (auto sub = static_cast<Subscription *>(msg->getContextPointer()))
+            pushChanges(*sub);
+        else
+            sendBack(msg);
     }
     else if (msg->getKind() == TCP_I_PEER_CLOSED) {
         // 处理连接关闭
         int connId = check_and_cast<Indication *>(msg)->getTag<SocketInd>()->getSocketId();
         delete msg;
+        unsubscribe(connId);
+        socketQueue.erase(connId);
         auto request = new Request("close", TCP_C_CLOSE);
         request->addTag<SocketReq>()->setSocketId(connId);
         sendOrSchedule(request, delay + maxMsgDelay);
     }
+    else if (msg->getKind() == TCP_I_CONNECTION_RESET || msg->getKind() == TCP_I_TIMED_OUT || msg->getKind() == TCP_I_CLOSED) {
+        // 连接已终止：取消订阅，避免之后的存储变化向已失效的socketId推送
+        int connId = check_and_cast<Indication *>(msg)->getTag<SocketInd>()->getSocketId();
+        EV_INFO << "socketId=" << connId << "连接终止（" << cEnum::get("inet::TcpStatusInd")->getStringFor(msg->getKind()) << "）" << endl;
+        delete msg;
+        unsubscribe(connId);
+        socketQueue.erase(connId);
+    }
     else if (msg->getKind() == TCP_I_DATA || msg->getKind() == TCP_I_URGENT_DATA) {
         Packet *packet = check_and_cast<Packet *>(msg);
         int connId = packet->getTag<SocketInd>()->getSocketId();
@@ -134,23 +312,30 @@ void ModbusTcpServerApp::handleMessage(cMessage *msg)
                 }
 
                 // 序列化modbusStorage到BytesChunk（使用长度前缀，支持分片重组）
-                auto payload = makeShared<BytesChunk>();
-                payload->setBytes(modbusStorage->serializeModbusStorageWithLength(modbusStorage));
-                if (!payload) {
-                    EV_ERROR << "Failed to serialize ModbusStorage" << endl;
-                    delete packet;
-                    continue;
+                // snapshotMode为0时沿用旧格式全量；为2且运维站版本不超过当前generation时只回复变化的寄存器组，
+                // 否则（首次请求、订阅或版本缺口，例如主站重启后generation变小）回复带版本的全量快照
+                // 存储未变化期间的重复请求复用缓存的chunk，不重新序列化
+                Ptr<const BytesChunk> payload;
+                uint8_t snapshotMode = listMsg->getSnapshotMode();
+                uint64_t lastSeenVersion = listMsg->getLastSeenVersion();
+                if (snapshotMode == 0) {
+                    payload = getSnapshotChunk(CACHE_LEGACY, modbusStorage, 0);
+                    numFullSnapshots++;
+                }
+                else if (snapshotMode == 2 && lastSeenVersion <= modbusStorage->getGeneration()) {
+                    payload = getSnapshotChunk(CACHE_DELTA, modbusStorage, lastSeenVersion);
+                    numDeltaSnapshots++;
+                }
+                else {
+                    if (snapshotMode == 2)
+                        EV_WARN << "ListMsg版本" << lastSeenVersion << "大于当前版本" << modbusStorage->getGeneration() << "，回复全量快照" << endl;
+                    if (snapshotMode == 3)
+                        subscribe(connId, listMsg->getSubscription(), modbusStorage->getGeneration());
+                    payload = getSnapshotChunk(CACHE_FULL, modbusStorage, 0);
+                    numFullSnapshots++;
                 }
 
-                // 创建回复包
-                Packet *outPacket = new Packet("ModbusStorageReply", TCP_C_SEND);
-                outPacket->addTag<SocketReq>()->setSocketId(connId);
-                // Tag both chunk and Packet for robust dataAge recording
-                payload->addTag<CreationTimeTag>()->setCreationTime(simTime());
-                outPacket->insertAtBack(payload);
-                outPacket->addTag<CreationTimeTag>()->setCreationTime(simTime());
-
-                sendOrSchedule(outPacket, delay);
+                sendOrSchedule(createStoragePacket("ModbusStorageReply", connId, payload), delay);
             }
             else {
                 EV_WARN << "Unsupported message type in queue, skipping" << endl;
@@ -178,6 +363,11 @@ void ModbusTcpServerApp::finish()
 {
     EV_INFO << getFullPath() << ": sent " << bytesSent << " bytes in " << msgsSent << " packets\n";
     EV_INFO << getFullPath() << ": received " << bytesRcvd << " bytes in " << msgsRcvd << " packets\n";
+    recordScalar("fullSnapshots", numFullSnapshots);
+    recordScalar("deltaSnapshots", numDeltaSnapshots);
+    recordScalar("pushes", numPushes);
+    recordScalar("snapshotCacheHits", snapshotCacheHits);
+    recordScalar("snapshotCacheMisses", snapshotCacheMisses);
 }
 
 } // namespace inet
\ No newline at end of file
@@ -10,13 +10,43 @@
 #include "ModbusStorage.h"
 #include "inet/common/lifecycle/LifecycleUnsupported.h"
 #include "inet/common/packet/ChunkQueue.h"
+#include "inet/common/packet/chunk/BytesChunk.h"
 #include "inet/transportlayer/contract/tcp/TcpSocket.h"
 
 namespace inet {
 
-class INET_API ModbusTcpServerApp : public cSimpleModule, public LifecycleUnsupported
+class INET_API ModbusTcpServerApp : public cSimpleModule, public cListener, public LifecycleUnsupported
 {
   protected:
+    // 订阅范围：slaveId/space为-1表示不限，地址区间为闭区间[start, end]
+    struct SubscriptionRange {
+        int slaveId = -1;
+        int space = -1;
+        uint16_t start = 0;
+        uint16_t end = 0xFFFF;
+    };
+
+    // 运维站的推送订阅（按socketId）
+    struct Subscription {
+        int connId = -1;
+        std::vector<SubscriptionRange> ranges;
+        uint64_t lastSeenVersion = 0;  // 已推送给该运维站的存储版本
+        simtime_t lastPush;            // 最近一次推送时间，用于合并minPushInterval内的变化
+        cMessage *pushTimer = nullptr;
+    };
+
+    // 快照缓存：存储的generation与结构版本（及增量的起始版本）不变时，后续请求共享同一个不可变chunk
+    enum SnapshotCacheKind { CACHE_LEGACY, CACHE_FULL, CACHE_DELTA, NUM_SNAPSHOT_CACHES };
+    struct SnapshotCache {
+        Ptr<const BytesChunk> chunk;
+        uint64_t generation = 0;
+        uint64_t structureVersion = 0;
+        uint64_t sinceVersion = 0;
+    };
+
+    static simsignal_t storageChangedSignal;
+
+
     TcpSocket socket;
     simtime_t delay;
     simtime_t maxMsgDelay;
@@ -25,12 +55,33 @@ class INET_API ModbusTcpServerApp : public cSimpleModule, public LifecycleUnsupp
     long msgsSent;
     long bytesRcvd;
     long bytesSent;
+    long numFullSnapshots;   // 回复的全量快照数（含旧格式）
+    long numDeltaSnapshots;  // 回复的增量快照数
+    long numPushes;          // 推送给订阅者的变化通知数
+    long snapshotCacheHits;
+    long snapshotCacheMisses;
+
+    SnapshotCache snapshotCache[NUM_SNAPSHOT_CACHES];
+
+    simtime_t minPushInterval;
+    std::map<int, Subscription> subscriptions;
 
     std::map<int, ChunkQueue> socketQueue;
 
   protected:
     virtual void sendBack(cMessage *msg);
     virtual void sendOrSchedule(cMessage *msg, simtime_t delay);
+    virtual Ptr<const BytesChunk> createStorageChunk(std::vector<uint8_t>&& bytes);
+    virtual Packet *createStoragePacket(const char *name, int connId, const Ptr<const BytesChunk>& payload);
+    virtual Ptr<const BytesChunk> getSnapshotChunk(SnapshotCacheKind kind, ModbusStorage *modbusStorage, uint64_t sinceVersion);
+
+    // 推送订阅
+    virtual std::vector<SubscriptionRange> parseSubscription(const char *spec) const;
+    virtual bool matchesSubscription(const Subscription& sub, const MSMapping& slave, AddressSpace space, uint16_t startAddress, uint16_t number) const;
+    virtual void subscribe(int connId, const char *spec, uint64_t generation);
+    virtual void unsubscribe(int connId);
+    virtual void pushChanges(Subscription& sub);
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, intval_t value, cObject *details) override;
 
     virtual void initialize(int stage) override;
     virtual int numInitStages() const override { return NUM_INIT_STAGES; }
@@ -38,6 +89,8 @@ class INET_API ModbusTcpServerApp : public cSimpleModule, public LifecycleUnsupp
     virtual void finish() override;
     virtual void refreshDisplay() const override;
 
+  public:
+    virtual ~ModbusTcpServerApp();
 };
 
 } // namespace inet
@@ -0,0 +1,96 @@
+//
+// Copyright (C) 2025 llw
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+//
+
+#ifndef __INET_MODBUSTIMERWHEEL_H
+#define __INET_MODBUSTIMERWHEEL_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "inet/common/INETDefs.h"
+
+namespace inet {
+
+// -----------------------------------------------------------------------------
+// 哈希时间轮：以固定粒度（tick）管理大量超时，所有条目共用一个定时消息驱动，
+// 而不是每个请求一个cMessage。插入O(1)，推进时只扫描经过的槽位。
+// 条目不支持主动删除（惰性取消）：到期后由调用方核对是否仍然有效。
+// -----------------------------------------------------------------------------
+template <typename Key>
+class TimerWheel {
+  public:
+    struct Entry {
+        Key key;
+        simtime_t deadline;
+    };
+
+  protected:
+    simtime_t tick = 0.01;
+    std::vector<std::vector<Entry>> slots;
+    int64_t cursor = 0;      // 已处理到的tick序号（含）
+    size_t numEntries = 0;   // 轮中条目总数（含已失效但尚未到期的条目）
+
+  public:
+    TimerWheel() : slots(256) {}
+
+    // 设置粒度和槽位数（仅在轮为空时调用）
+    void setup(simtime_t tickLength, int numSlots) {
+        if (tickLength <= SIMTIME_ZERO || numSlots < 1)
+            throw cRuntimeError("TimerWheel: invalid tick length or slot count");
+        tick = tickLength;
+        slots.assign(numSlots, std::vector<Entry>());
+        numEntries = 0;
+    }
+
+    // 将推进位置对齐到当前时间（轮为空时开始计时前调用）
+    void reset(simtime_t now) {
+        for (auto& slot : slots)
+            slot.clear();
+        numEntries = 0;
+        cursor = (int64_t)std::floor(now / tick);
+    }
+
+    bool empty() const { return numEntries == 0; }
+    size_t size() const { return numEntries; }
+
+    void insert(const Key& key, simtime_t deadline) {
+        int64_t t = (int64_t)std::ceil(deadline / tick);
+        if (t <= cursor)
+            t = cursor + 1;  // 已过期的条目在下一个tick处理
+        slots[t % slots.size()].push_back(Entry{key, deadline});
+        numEntries++;
+    }
+
+    // 推进到now，将到期（deadline <= now）的条目追加到expired
+    void advance(simtime_t now, std::vector<Entry>& expired) {
+        int64_t nowTick = (int64_t)std::floor(now / tick);
+        if (nowTick <= cursor && now >= getNextTickTime())
+            nowTick = cursor + 1;  // 防止除法舍入导致恰在tick边界时无法推进
+        if (nowTick <= cursor)
+            return;
+        int64_t steps = std::min<int64_t>(nowTick - cursor, slots.size());
+        for (int64_t i = 1; i <= steps && numEntries > 0; i++) {
+            auto& slot = slots[(cursor + i) % slots.size()];
+            size_t kept = 0;
+            for (size_t j = 0; j < slot.size(); j++) {
+                if (slot[j].deadline <= now)
+                    expired.push_back(slot[j]);
+                else
+                    slot[kept++] = slot[j];  // 后续轮次才到期
+            }
+            numEntries -= slot.size() - kept;
+            slot.resize(kept);
+        }
+        cursor = nowTick;
+    }
+
+    // 下一个需要推进的时刻（tick边界）
+    simtime_t getNextTickTime() const { return tick * (cursor + 1); }
+};
+
+} // namespace inet
+
+#endif // __INET_MODBUSTIMERWHEEL_H
@@ -43,6 +43,8 @@ namespace inet
             startTime = par("startTime");
             stopTime = par("stopTime");
             interval = par("interval");
+            deltaSnapshots = par("deltaSnapshots");
+            subscription = par("subscription").stdstringValue();
 
             // 时间参数校验
             if (stopTime >= SIMTIME_ZERO && stopTime < startTime)
@@ -84,6 +86,18 @@ namespace inet
         Packet *packet = new Packet("data");
         header->setSequenceNumber(++sequenceNumber);
         header->setIfList(true);
+        if (!subscription.empty()) {
+            // 订阅：服务器先回复全量快照，之后按订阅范围推送变化
+            header->setSnapshotMode(3);
+            header->setSubscription(subscription.c_str());
+            header->setChunkLength(B(16 + subscription.size()));
+            subscribePending = true;
+        }
+        else if (deltaSnapshots) {
+            // 已有带版本的副本时只请求其后的变化，否则请求带版本的全量快照作为基准
+            header->setSnapshotMode(storage->hasSnapshotBase() ? 2 : 1);
+            header->setLastSeenVersion(storage->getGeneration());
+        }
         // Tag both the chunk and the Packet to maximize compatibility with dataAge(packetReceived)
         header->addTag<CreationTimeTag>()->setCreationTime(simTime());
         packet->addTag<CreationTimeTag>()->setCreationTime(simTime());
@@ -136,7 +150,8 @@ namespace inet
 
         if (!earlySend) {
             sendRequest();
-            rescheduleAfterOrDeleteTimer(interval, MSGKIND_SEND);
+            if (subscription.empty())
+                rescheduleAfterOrDeleteTimer(interval, MSGKIND_SEND);
         }
     }
 
@@ -169,6 +184,15 @@ namespace inet
             EV_INFO << "成功反序列化ModbusStorage消息，长度=" << consumed
                     << ", 剩余未处理字节=" << recvBuffer.size() << endl;
         }
+        // 订阅模式下推送帧与本地副本不一致（版本缺口或结构不符）时重新订阅以取得新的全量快照
+        if (!subscription.empty() && messagesParsed > 0) {
+            if (storage->hasSnapshotBase())
+                subscribePending = false;
+            else if (!subscribePending) {
+                EV_WARN << "推送数据与本地副本不一致，重新订阅" << endl;
+                sendRequest();
+            }
+        }
         if (messagesParsed == 0) {
             EV_DEBUG << "当前缓冲区字节数=" << recvBuffer.size()
                      << "，尚未形成完整ModbusStorage消息，继续等待后续分片" << endl;
@@ -27,6 +27,9 @@ namespace inet{
           simtime_t stopTime;
           simtime_t interval;
           uint32_t sequenceNumber = 0;
+          bool deltaSnapshots = false;  // 请求增量快照（携带本地副本版本）
+          std::string subscription;     // 非空时订阅该范围，由服务器推送变化，不再周期轮询
+          bool subscribePending = false; // 已发送订阅，尚未收到作为推送基准的全量快照
           std::string modbusRequest;  // 存储modbus请求字符串
           simtime_t sendTime;         // 发送OperatorRequest的时间
 
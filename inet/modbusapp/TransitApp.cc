@@ -348,14 +348,10 @@ void TransitApp::handleMessage(cMessage *msg)
                 // 8. 获取目标socket并发送报文
                 if (requestPacket) {
                     EV_INFO << "将请求报文加入发送队列，目标socketId: " << targetSocketId << ", 报文ID: " << requestPacket->getId() << endl;
-                    // peek chunk BEFORE calling addPacketToQueue because addPacketToQueue deletes the Packet
-                    auto transitChunk = requestPacket->peekDataAt(B(0), requestPacket->getTotalLength());
-                    transitQueue->push(transitChunk);
-                    EV_INFO << "中转消息已成功加入发送队列" << endl;
-
-                    // addPacketToQueue will delete the Packet, so call it after we've extracted the chunk
-                    modbusMasterApp->addPacketToQueue(requestPacket, targetSocketId);
+                    // 主站按事务ID记录中转请求，响应到达时经sendBack()回送；addPacketToQueue会释放Packet
+                    modbusMasterApp->addPacketToQueue(requestPacket, targetSocketId, true);
                     requestPacket = nullptr; // ownership moved/deleted
+                    EV_INFO << "中转消息已成功加入发送队列" << endl;
                 }
             }
             // 处理其他类型消息
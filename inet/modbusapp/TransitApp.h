@@ -28,7 +28,6 @@ class INET_API TransitApp : public cSimpleModule, public LifecycleUnsupported
     long bytesSent;
 
     std::map<int, ChunkQueue> socketQueue;
-    ChunkQueue* transitQueue = new ChunkQueue();
 
   protected:
 
@@ -41,7 +40,6 @@ class INET_API TransitApp : public cSimpleModule, public LifecycleUnsupported
     virtual void refreshDisplay() const override;
 
   public:
-    ChunkQueue* getTransitQueue(){return transitQueue;}
     void sendBack(cMessage *msg);
 //    int getSocketId(){return socket.getSocketId();}
 